@@ -0,0 +1,354 @@
+/*
+ *       Filename:  arrow_ipc.h
+ *    Description:  Minimal writer of the Apache Arrow IPC streaming format, without the Arrow or FlatBuffers libraries.
+ *                  Only what --format=arrow needs: integer, timestamp, UTF-8, list and struct columns with int32
+ *                  dictionary indices, uncompressed little-endian buffers, metadata version V5
+ */
+
+#ifndef arrow_ipc_h_included
+#define arrow_ipc_h_included
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/*  Type union indices of Schema.fbs */
+#define ARROW_TYPE_INT		2
+#define ARROW_TYPE_UTF8		5
+#define ARROW_TYPE_TIMESTAMP	10
+#define ARROW_TYPE_LIST		12
+#define ARROW_TYPE_STRUCT	13
+
+#define ARROW_TIME_MICROSECOND	2
+
+/*  MessageHeader union indices of Message.fbs */
+#define ARROW_HEADER_SCHEMA		1
+#define ARROW_HEADER_DICTIONARY_BATCH	2
+#define ARROW_HEADER_RECORD_BATCH	3
+
+#define ARROW_METADATA_V5	4
+
+/*  Builds a flatbuffer front to back: a table is written with its inline fields, its vtable right after it and the
+ *  tables, vectors and strings it points to after that. The offsets of a table are reserved by AddOffset() and
+ *  filled in by Patch() once the object they point to is written; all of them point forward, as they have to */
+class FlatBuilder {
+public:
+	FlatBuilder() : buffer(4, 0), tableStart(0) {}
+
+	size_t	BeginTable(unsigned numFields) {
+		Align(8);
+		tableStart = buffer.size();
+		fieldPos.assign(numFields, 0);
+		Append<int32_t>(0);
+		return tableStart;
+	}
+
+	template<class T>
+	void	AddScalar(unsigned field, T value) {
+		Align(sizeof(T));
+		fieldPos[field] = (uint16_t)( buffer.size() - tableStart );
+		Append<T>(value);
+	}
+
+	size_t	AddOffset(unsigned field) {
+		Align(4);
+		fieldPos[field] = (uint16_t)( buffer.size() - tableStart );
+		Append<uint32_t>(0);
+		return buffer.size() - 4;
+	}
+
+	void	EndTable() {
+		uint16_t	tableSize	=	(uint16_t)( buffer.size() - tableStart );
+		size_t		vtable;
+		int32_t		toVtable;
+
+		Align(2);
+		vtable = buffer.size();
+		Append<uint16_t>((uint16_t)( 4 + 2 * fieldPos.size() ));
+		Append<uint16_t>(tableSize);
+		for (auto pos : fieldPos)
+			Append<uint16_t>(pos);
+		toVtable = (int32_t)( (int64_t)tableStart - (int64_t)vtable );	/*  the table minus this is the vtable */
+		memcpy(&buffer[tableStart], &toVtable, sizeof(toVtable));
+	}
+
+	size_t	AddString(const char* str) {
+		size_t	len	=	strlen(str);
+		size_t	pos;
+
+		Align(4);
+		pos = buffer.size();
+		Append<uint32_t>((uint32_t)len);
+		buffer.insert(buffer.end(), str, str + len + 1);
+		return pos;
+	}
+
+	/*  count offsets to fill in with Patch(), at VectorSlot() */
+	size_t	AddOffsetVector(size_t count) {
+		size_t	pos;
+
+		Align(4);
+		pos = buffer.size();
+		Append<uint32_t>((uint32_t)count);
+		buffer.resize(buffer.size() + 4 * count, 0);
+		return pos;
+	}
+
+	size_t	VectorSlot(size_t vector, size_t idx) const {
+		return vector + 4 + 4 * idx;
+	}
+
+	/*  A vector of structs of two int64, FieldNode and Buffer */
+	size_t	AddPairVector(const std::vector<int64_t>& pairs) {
+		size_t	pos;
+
+		while ( ( buffer.size() + 4 ) % 8 != 0 )
+			buffer.push_back(0);
+		pos = buffer.size();
+		Append<uint32_t>((uint32_t)( pairs.size() / 2 ));
+		for (auto value : pairs)
+			Append<int64_t>(value);
+		return pos;
+	}
+
+	void	Patch(size_t slot, size_t target) {
+		uint32_t	offset	=	(uint32_t)( target - slot );
+
+		memcpy(&buffer[slot], &offset, sizeof(offset));
+	}
+
+	/*  The root table, then the buffer is padded to 8 bytes */
+	const std::vector<uint8_t>&	Finish(size_t root) {
+		Patch(0, root);
+		Align(8);
+		return buffer;
+	}
+
+private:
+	void	Align(size_t alignment) {
+		while ( buffer.size() % alignment != 0 )
+			buffer.push_back(0);
+	}
+
+	template<class T>
+	void	Append(T value) {
+		size_t	pos	=	buffer.size();
+
+		buffer.resize(pos + sizeof(value));
+		memcpy(&buffer[pos], &value, sizeof(value));
+	}
+
+	std::vector<uint8_t>	buffer;
+	size_t			tableStart;
+	std::vector<uint16_t>	fieldPos;	/*  of the open table, 0 for the absent fields */
+};
+
+struct ArrowField {
+	ArrowField(const char* fieldName, uint8_t fieldType, bool isNullable = false) : name(fieldName), type(fieldType), bitWidth(0), isSigned(false),
+		timeUnit(0), timezone(NULL), nullable(isNullable), dictionaryID(-1) {}
+
+	const char*		name;
+	uint8_t			type;		/*  ARROW_TYPE_* */
+	uint8_t			bitWidth;	/*  ARROW_TYPE_INT */
+	bool			isSigned;
+	uint8_t			timeUnit;	/*  ARROW_TYPE_TIMESTAMP */
+	const char*		timezone;
+	bool			nullable;
+	int64_t			dictionaryID;	/*  int32 indices into the dictionary of this ID, -1 if the values are stored */
+	std::vector<ArrowField>	children;
+};
+
+/*  One buffer of the body of a batch */
+struct ArrowBuffer {
+	ArrowBuffer(const void* bufferData = NULL, size_t bufferLen = 0) : data(bufferData), len(bufferLen) {}
+	const void*	data;
+	size_t		len;
+};
+
+/*  Writes the messages of one stream: the schema, dictionary and record batches, the end marker */
+class ArrowStreamWriter {
+public:
+	ArrowStreamWriter(FILE* output) : out(output) {}
+
+	void	WriteSchema(const std::vector<ArrowField>& fields) {
+		FlatBuilder	b;
+		size_t		message	=	BeginMessage(b, ARROW_HEADER_SCHEMA, 0);
+		size_t		header	=	b.AddOffset(2);
+		size_t		fieldVector;
+
+		b.EndTable();
+		b.Patch(header, b.BeginTable(4));
+		b.AddScalar<int16_t>(0, 0);	/*  little endian */
+		fieldVector = b.AddOffset(1);
+		b.EndTable();
+		AddFields(b, fieldVector, fields);
+		WriteMessage(b.Finish(message), std::vector<ArrowBuffer>());
+	}
+
+	/*  nodes holds a (length, null count) pair for every field and child in depth-first order, buffers their buffers */
+	void	WriteRecordBatch(int64_t length, const std::vector<int64_t>& nodes, const std::vector<ArrowBuffer>& buffers) {
+		FlatBuilder	b;
+		size_t		message	=	BeginMessage(b, ARROW_HEADER_RECORD_BATCH, BodyLength(buffers));
+		size_t		header	=	b.AddOffset(2);
+
+		b.EndTable();
+		AddRecordBatch(b, header, length, nodes, buffers);
+		WriteMessage(b.Finish(message), buffers);
+	}
+
+	/*  A delta adds values to the dictionary of that ID, the first batch of an ID can't be one */
+	void	WriteDictionaryBatch(int64_t id, bool isDelta, int64_t length, const std::vector<int64_t>& nodes, const std::vector<ArrowBuffer>& buffers) {
+		FlatBuilder	b;
+		size_t		message	=	BeginMessage(b, ARROW_HEADER_DICTIONARY_BATCH, BodyLength(buffers));
+		size_t		header	=	b.AddOffset(2);
+		size_t		data;
+
+		b.EndTable();
+		b.Patch(header, b.BeginTable(3));
+		b.AddScalar<int64_t>(0, id);
+		data = b.AddOffset(1);
+		b.AddScalar<uint8_t>(2, isDelta ? 1 : 0);
+		b.EndTable();
+		AddRecordBatch(b, data, length, nodes, buffers);
+		WriteMessage(b.Finish(message), buffers);
+	}
+
+	void	WriteEnd() {
+		static const uint32_t	endOfStream[2]	=	{ 0xFFFFFFFF, 0 };
+
+		fwrite(endOfStream, 1, sizeof(endOfStream), out);
+	}
+
+private:
+	static size_t	Padded(size_t len) {
+		return ( len + 7 ) & ~(size_t)7;
+	}
+
+	static int64_t	BodyLength(const std::vector<ArrowBuffer>& buffers) {
+		size_t	len	=	0;
+
+		for (auto& buffer : buffers)
+			len += Padded(buffer.len);
+		return len;
+	}
+
+	/*  The Message table, its header offset is added by the caller */
+	static size_t	BeginMessage(FlatBuilder& b, uint8_t headerType, int64_t bodyLength) {
+		size_t	message	=	b.BeginTable(5);
+
+		b.AddScalar<int16_t>(0, ARROW_METADATA_V5);
+		b.AddScalar<uint8_t>(1, headerType);
+		b.AddScalar<int64_t>(3, bodyLength);
+		return message;
+	}
+
+	static void	AddRecordBatch(FlatBuilder& b, size_t slot, int64_t length, const std::vector<int64_t>& nodes, const std::vector<ArrowBuffer>& buffers) {
+		std::vector<int64_t>	layout;
+		size_t			nodeVector;
+		size_t			bufferVector;
+		size_t			offset	=	0;
+
+		b.Patch(slot, b.BeginTable(4));
+		b.AddScalar<int64_t>(0, length);
+		nodeVector = b.AddOffset(1);
+		bufferVector = b.AddOffset(2);
+		b.EndTable();
+		b.Patch(nodeVector, b.AddPairVector(nodes));
+		for (auto& buffer : buffers)
+		{
+			layout.push_back(offset);
+			layout.push_back(buffer.len);
+			offset += Padded(buffer.len);
+		}
+		b.Patch(bufferVector, b.AddPairVector(layout));
+	}
+
+	static void	AddFields(FlatBuilder& b, size_t slot, const std::vector<ArrowField>& fields) {
+		size_t	vector	=	b.AddOffsetVector(fields.size());
+
+		b.Patch(slot, vector);
+		for (size_t idx = 0; idx < fields.size(); idx++)
+			AddField(b, b.VectorSlot(vector, idx), fields[idx]);
+	}
+
+	static void	AddField(FlatBuilder& b, size_t slot, const ArrowField& field) {
+		size_t	name;
+		size_t	type;
+		size_t	dictionary	=	0;
+		size_t	children;
+
+		b.Patch(slot, b.BeginTable(7));
+		name = b.AddOffset(0);
+		b.AddScalar<uint8_t>(1, field.nullable ? 1 : 0);
+		b.AddScalar<uint8_t>(2, field.type);
+		type = b.AddOffset(3);
+		if ( field.dictionaryID >= 0 )
+			dictionary = b.AddOffset(4);
+		children = b.AddOffset(5);	/*  readers want the vector even if it is empty */
+		b.EndTable();
+
+		b.Patch(name, b.AddString(field.name));
+		switch ( field.type )
+		{
+		case ARROW_TYPE_INT:
+			AddInt(b, type, field.bitWidth, field.isSigned);
+			break;
+		case ARROW_TYPE_TIMESTAMP:
+			{
+				size_t	timezone;
+
+				b.Patch(type, b.BeginTable(2));
+				b.AddScalar<int16_t>(0, field.timeUnit);
+				timezone = ( field.timezone != NULL ) ? b.AddOffset(1) : 0;
+				b.EndTable();
+				if ( field.timezone != NULL )
+					b.Patch(timezone, b.AddString(field.timezone));
+			}
+			break;
+		default:
+			/*  Utf8, List and Struct_ have no fields */
+			b.Patch(type, b.BeginTable(0));
+			b.EndTable();
+			break;
+		}
+		if ( field.dictionaryID >= 0 )
+		{
+			size_t	indexType;
+
+			b.Patch(dictionary, b.BeginTable(4));
+			b.AddScalar<int64_t>(0, field.dictionaryID);
+			indexType = b.AddOffset(1);
+			b.EndTable();
+			AddInt(b, indexType, 32, true);
+		}
+		AddFields(b, children, field.children);
+	}
+
+	static void	AddInt(FlatBuilder& b, size_t slot, uint8_t bitWidth, bool isSigned) {
+		b.Patch(slot, b.BeginTable(2));
+		b.AddScalar<int32_t>(0, bitWidth);
+		b.AddScalar<uint8_t>(1, isSigned ? 1 : 0);
+		b.EndTable();
+	}
+
+	/*  Continuation marker, metadata length, the metadata and the body, each part padded to 8 bytes */
+	void	WriteMessage(const std::vector<uint8_t>& metadata, const std::vector<ArrowBuffer>& buffers) {
+		static const uint8_t	padding[8]	=	{ 0 };
+		uint32_t		prefix[2]	=	{ 0xFFFFFFFF, (uint32_t)metadata.size() };
+
+		fwrite(prefix, 1, sizeof(prefix), out);
+		fwrite(&metadata[0], 1, metadata.size(), out);
+		for (auto& buffer : buffers)
+		{
+			if ( buffer.len != 0 )
+				fwrite(buffer.data, 1, buffer.len, out);
+			fwrite(padding, 1, Padded(buffer.len) - buffer.len, out);
+		}
+	}
+
+	FILE*	out;
+};
+
+#endif
@@ -0,0 +1,800 @@
+/*
+ *       Filename:  bench_parse_evtx.cpp
+ *    Description:  Reproducible synthetic EVTX corpus and a benchmark of the parser stages
+ */
+
+#define EVTX_PARSER_NO_API	1
+#include "evtx_parser.cpp"
+
+#include <chrono>
+
+/*  Every allocation of the process is counted, the parser has no other way to allocate */
+static std::atomic<uint64_t>	numAllocations(0);
+
+void*	operator new(size_t size)
+{
+	void*	result	=	malloc(size ? size : 1);
+
+	numAllocations++;
+	if ( result == NULL )
+		throw std::bad_alloc();
+	return result;
+}
+
+void*	operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void*	operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	numAllocations++;
+	return malloc(size ? size : 1);
+}
+
+void*	operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	numAllocations++;
+	return malloc(size ? size : 1);
+}
+
+void	operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void	operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+namespace {
+
+/*  xorshift64*, gives the same corpus on every platform */
+class BenchRandom {
+public:
+	BenchRandom(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+	uint64_t	Next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1DULL;
+	}
+
+	uint32_t	Below(uint32_t limit) {
+		return limit ? (uint32_t)( Next() % limit ) : 0;
+	}
+
+private:
+	uint64_t	state;
+};
+
+struct CorpusOptions {
+	CorpusOptions() : numChunks(320), numTemplates(12), maxStringLength(64), seed(1) {
+		static const uint8_t	defaultTypes[]	=	{ 0x01, 0x02, 0x04, 0x06, 0x08, 0x0A, 0x0E, 0x0F, 0x11, 0x13, 0x14, 0x15, 0x81 };
+
+		types.assign(defaultTypes, defaultTypes + countof(defaultTypes));
+	}
+	uint32_t		numChunks;
+	uint32_t		numTemplates;
+	uint32_t		maxStringLength;	/*  characters */
+	uint64_t		seed;
+	std::vector<uint8_t>	types;			/*  BinXml value types of the EventData substitutions */
+};
+
+struct BenchField {
+	const char*	key;
+	uint8_t		type;
+};
+
+struct BenchTemplate {
+	uint32_t		id;
+	const char*		provider;
+	const char*		channel;
+	uint16_t		eventID;	/*  0 if the EventID is a substitution */
+	std::vector<BenchField>	fields;
+};
+
+#define BENCH_FIXED_VALUES	6	/*  substitutions of the System part come before the EventData fields */
+
+static const uint16_t	benchEventIDs[]	=	{ 4624, 4625, 4634, 4672, 4688, 4720, 7045, 1102 };
+
+/*  Writes BinXml the way the event log service does: names and template definitions inline at the first use in a chunk */
+class ChunkWriter {
+public:
+	ChunkWriter() : buf(sizeof(EvtxChunkHeader), 0) {}
+
+	size_t	Pos() const {
+		return buf.size();
+	}
+
+	void	Put(const void* data, size_t len) {
+		buf.insert(buf.end(), (const uint8_t*)data, (const uint8_t*)data + len);
+	}
+
+	template<class c>
+	void	PutValue(c value) {
+		Put(&value, sizeof(value));
+	}
+
+	template<class c>
+	void	Patch(size_t pos, c value) {
+		memcpy(&buf[pos], &value, sizeof(value));
+	}
+
+	void	PutUTF16(const char* str, size_t len) {
+		for (size_t idx = 0; idx < len; idx++)
+			PutValue<uint16_t>((uint8_t)str[idx]);
+	}
+
+	void	Name(const char* name) {
+		auto	known	=	names.find(name);
+
+		if ( known != names.end() )
+		{
+			PutValue<uint32_t>(known->second);
+			return;
+		}
+
+		uint32_t	offset	=	Pos() + sizeof(uint32_t);
+
+		names[name] = offset;
+		PutValue<uint32_t>(offset);
+		PutValue<uint32_t>(0);		/*  next name in the hash bucket */
+		PutValue<uint16_t>(0);		/*  hash */
+		PutValue<uint16_t>(strlen(name));
+		PutUTF16(name, strlen(name));
+		PutValue<uint16_t>(0);
+	}
+
+	void	Text(const char* text) {
+		PutValue<uint8_t>(0x05);
+		PutValue<uint8_t>(0x01);
+		PutValue<uint16_t>(strlen(text));
+		PutUTF16(text, strlen(text));
+	}
+
+	void	Substitution(uint16_t id, uint8_t type) {
+		PutValue<uint8_t>(0x0E);
+		PutValue<uint16_t>(id);
+		PutValue<uint8_t>(type);
+	}
+
+	/*  Returns where the element size goes */
+	size_t	OpenElement(const char* name, bool hasAttributes) {
+		size_t	sizePos;
+
+		PutValue<uint8_t>(hasAttributes ? 0x41 : 0x01);
+		PutValue<uint16_t>(0xFFFF);
+		sizePos = Pos();
+		PutValue<uint32_t>(0);
+		Name(name);
+		if ( hasAttributes )
+		{
+			attributeSizePos = Pos();
+			PutValue<uint32_t>(0);
+		}
+		return sizePos;
+	}
+
+	void	Attribute(const char* name, bool isLast) {
+		PutValue<uint8_t>(isLast ? 0x06 : 0x46);
+		Name(name);
+	}
+
+	void	EndAttributes() {
+		Patch<uint32_t>(attributeSizePos, Pos() - attributeSizePos - sizeof(uint32_t));
+	}
+
+	void	CloseElement(size_t sizePos, bool isEmpty) {
+		PutValue<uint8_t>(isEmpty ? 0x03 : 0x04);
+		Patch<uint32_t>(sizePos, Pos() - sizePos - sizeof(uint32_t));
+	}
+
+	void	StartContent() {
+		PutValue<uint8_t>(0x02);
+	}
+
+	std::vector<uint8_t>		buf;
+	std::map<std::string, uint32_t>	names;
+	std::map<uint32_t, uint32_t>	templates;	/*  template ID to the offset of its definition */
+	size_t				attributeSizePos;
+};
+
+void	WriteTemplateBody(ChunkWriter& w, const BenchTemplate& tmpl)
+{
+	size_t	event, system, element, eventData;
+
+	w.PutValue<uint32_t>(0x0001010F);	/*  fragment header */
+
+	event = w.OpenElement("Event", true);
+	w.Attribute("xmlns", true);
+	w.Text("http://schemas.microsoft.com/win/2004/08/events/event");
+	w.EndAttributes();
+	w.StartContent();
+
+	system = w.OpenElement("System", false);
+	w.StartContent();
+
+	element = w.OpenElement("Provider", true);
+	w.Attribute("Name", true);
+	w.Text(tmpl.provider);
+	w.EndAttributes();
+	w.CloseElement(element, true);
+
+	element = w.OpenElement("EventID", false);
+	w.StartContent();
+	if ( tmpl.eventID != 0 )
+	{
+		char	eventID[8];
+
+		snprintf(eventID, sizeof(eventID), "%u", tmpl.eventID);
+		w.Text(eventID);
+	}
+	else
+	{
+		w.Substitution(0, 0x06);
+	}
+	w.CloseElement(element, false);
+
+	element = w.OpenElement("Level", false);
+	w.StartContent();
+	w.Substitution(1, 0x04);
+	w.CloseElement(element, false);
+
+	element = w.OpenElement("TimeCreated", true);
+	w.Attribute("SystemTime", true);
+	w.Substitution(2, 0x11);
+	w.EndAttributes();
+	w.CloseElement(element, true);
+
+	element = w.OpenElement("EventRecordID", false);
+	w.StartContent();
+	w.Substitution(3, 0x0A);
+	w.CloseElement(element, false);
+
+	element = w.OpenElement("Channel", false);
+	w.StartContent();
+	w.Text(tmpl.channel);
+	w.CloseElement(element, false);
+
+	element = w.OpenElement("Computer", false);
+	w.StartContent();
+	w.Substitution(4, 0x01);
+	w.CloseElement(element, false);
+
+	element = w.OpenElement("Security", true);
+	w.Attribute("UserID", true);
+	w.Substitution(5, 0x13);
+	w.EndAttributes();
+	w.CloseElement(element, true);
+
+	w.CloseElement(system, false);
+
+	eventData = w.OpenElement("EventData", false);
+	w.StartContent();
+	for (size_t idx = 0; idx < tmpl.fields.size(); idx++)
+	{
+		element = w.OpenElement("Data", true);
+		w.Attribute("Name", true);
+		w.Text(tmpl.fields[idx].key);
+		w.EndAttributes();
+		w.StartContent();
+		w.Substitution(BENCH_FIXED_VALUES + idx, tmpl.fields[idx].type);
+		w.CloseElement(element, false);
+	}
+	w.CloseElement(eventData, false);
+
+	w.CloseElement(event, false);
+	w.PutValue<uint8_t>(0x00);
+}
+
+void	PutBenchString(std::vector<uint8_t>& value, BenchRandom& rnd, uint32_t maxLength, bool wide)
+{
+	static const char	alphabet[]	=	"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 \\._-:";
+	uint32_t		length		=	rnd.Below(maxLength + 1);
+	bool			nonASCII	=	wide && rnd.Below(10) == 0;
+
+	for (uint32_t idx = 0; idx < length; idx++)
+	{
+		uint16_t	c	=	nonASCII && rnd.Below(2) ? 0x0410 + rnd.Below(0x40) : alphabet[rnd.Below(sizeof(alphabet) - 1)];
+
+		value.push_back(c & 0xFF);
+		if ( wide )
+			value.push_back(c >> 8);
+	}
+}
+
+template<class c>
+void	PutBenchValue(std::vector<uint8_t>& value, c v)
+{
+	value.insert(value.end(), (const uint8_t*)&v, (const uint8_t*)&v + sizeof(v));
+}
+
+void	MakeBenchValue(std::vector<uint8_t>& value, uint8_t type, BenchRandom& rnd, const CorpusOptions& options)
+{
+	uint32_t	count;
+
+	value.clear();
+	switch ( type )
+	{
+	case 0x01:
+		PutBenchString(value, rnd, options.maxStringLength, true);
+		break;
+	case 0x02:
+		PutBenchString(value, rnd, options.maxStringLength, false);
+		break;
+	case 0x04:
+		PutBenchValue<uint8_t>(value, rnd.Next());
+		break;
+	case 0x06:
+		PutBenchValue<uint16_t>(value, benchEventIDs[rnd.Below(countof(benchEventIDs))]);
+		break;
+	case 0x08:
+		PutBenchValue<uint32_t>(value, rnd.Below(12));
+		break;
+	case 0x0A:
+	case 0x15:
+		PutBenchValue<uint64_t>(value, rnd.Next());
+		break;
+	case 0x0E:
+		count = rnd.Below(33);
+		for (uint32_t idx = 0; idx < count; idx++)
+			PutBenchValue<uint8_t>(value, rnd.Next());
+		break;
+	case 0x0F:
+		PutBenchValue<uint64_t>(value, rnd.Next());
+		PutBenchValue<uint64_t>(value, rnd.Next());
+		break;
+	case 0x11:
+		PutBenchValue<uint64_t>(value, 131000000000000000ULL + ( rnd.Next() >> 12 ));
+		break;
+	case 0x13:
+		count = 1 + rnd.Below(5);
+		PutBenchValue<uint8_t>(value, 1);
+		PutBenchValue<uint8_t>(value, count);
+		PutBenchValue<uint32_t>(value, 0);
+		PutBenchValue<uint8_t>(value, 0);
+		PutBenchValue<uint8_t>(value, 5);
+		for (uint32_t idx = 0; idx < count; idx++)
+			PutBenchValue<uint32_t>(value, rnd.Next());
+		break;
+	case 0x14:
+		PutBenchValue<uint32_t>(value, rnd.Next());
+		break;
+	case 0x81:
+		count = rnd.Below(5);
+		for (uint32_t idx = 0; idx < count; idx++)
+		{
+			PutBenchString(value, rnd, options.maxStringLength / 4, true);
+			PutBenchValue<uint16_t>(value, 0);
+		}
+		break;
+	}
+}
+
+std::vector<BenchTemplate>	MakeBenchTemplates(BenchRandom& rnd, const CorpusOptions& options)
+{
+	static const char*	keys[]		=	{ "SubjectUserSid", "SubjectUserName", "SubjectDomainName", "SubjectLogonId", "TargetUserName",
+							"TargetDomainName", "LogonType", "LogonProcessName", "WorkstationName", "IpAddress", "IpPort",
+							"ProcessId", "ProcessName", "CommandLine", "ServiceName", "ImagePath", "Status", "Hashes" };
+	static const char*	providers[]	=	{ "Microsoft-Windows-Security-Auditing", "Service Control Manager", "Microsoft-Windows-Sysmon" };
+	std::vector<BenchTemplate>	templates(options.numTemplates);
+
+	for (uint32_t idx = 0; idx < options.numTemplates; idx++)
+	{
+		BenchTemplate&	tmpl		=	templates[idx];
+		uint32_t	numFields	=	1 + rnd.Below(12);
+
+		tmpl.id = 0x1000 + idx;
+		tmpl.provider = providers[rnd.Below(countof(providers))];
+		tmpl.channel = rnd.Below(2) ? "Security" : "System";
+		tmpl.eventID = rnd.Below(2) ? benchEventIDs[rnd.Below(countof(benchEventIDs))] : 0;
+		for (uint32_t field = 0; field < numFields; field++)
+		{
+			BenchField	f;
+
+			f.key = keys[rnd.Below(countof(keys))];
+			f.type = options.types[rnd.Below(options.types.size())];
+			if ( !strcmp(f.key, "LogonType") )
+				f.type = 0x08;
+			tmpl.fields.push_back(f);
+		}
+	}
+
+	return templates;
+}
+
+void	WriteBenchRecord(ChunkWriter& w, const BenchTemplate& tmpl, uint64_t number, BenchRandom& rnd, const CorpusOptions& options)
+{
+	size_t			recordStart	=	w.Pos();
+	std::vector<uint8_t>	values[BENCH_FIXED_VALUES];
+	std::vector<uint8_t>	fieldValue;
+	std::vector<uint8_t>	data;
+	std::vector<uint32_t>	descriptors;
+	uint64_t		timestamp	=	131500000000000000ULL + number * 370000000ULL + rnd.Below(10000000);
+	auto			known		=	w.templates.find(tmpl.id);
+
+	w.PutValue<uint32_t>(0x00002a2a);
+	w.PutValue<uint32_t>(0);
+	w.PutValue<uint64_t>(number);
+	w.PutValue<uint64_t>(timestamp);
+
+	w.PutValue<uint32_t>(0x0001010F);
+	w.PutValue<uint8_t>(0x0C);
+	w.PutValue<uint8_t>(0x01);
+	w.PutValue<uint32_t>(tmpl.id);
+	if ( known != w.templates.end() )
+	{
+		w.PutValue<uint32_t>(known->second);
+	}
+	else
+	{
+		uint32_t	definition	=	w.Pos() + sizeof(uint32_t);
+		size_t		bodySizePos;
+
+		w.templates[tmpl.id] = definition;
+		w.PutValue<uint32_t>(definition);
+		w.PutValue<uint32_t>(0);	/*  next definition */
+		w.PutValue<uint64_t>(tmpl.id);	/*  GUID */
+		w.PutValue<uint64_t>(0);
+		bodySizePos = w.Pos();
+		w.PutValue<uint32_t>(0);
+		WriteTemplateBody(w, tmpl);
+		w.Patch<uint32_t>(bodySizePos, w.Pos() - bodySizePos - sizeof(uint32_t));
+	}
+
+	/*  the System part */
+	if ( tmpl.eventID == 0 )
+		MakeBenchValue(values[0], 0x06, rnd, options);
+	PutBenchValue<uint8_t>(values[1], 4);
+	PutBenchValue<uint64_t>(values[2], timestamp);
+	PutBenchValue<uint64_t>(values[3], number);
+	PutBenchValue<uint8_t>(values[4], 'H');
+	PutBenchValue<uint8_t>(values[4], 0);
+	MakeBenchValue(values[5], 0x13, rnd, options);
+
+	static const uint8_t	fixedTypes[BENCH_FIXED_VALUES]	=	{ 0x06, 0x04, 0x11, 0x0A, 0x01, 0x13 };
+
+	for (int idx = 0; idx < BENCH_FIXED_VALUES; idx++)
+	{
+		descriptors.push_back(values[idx].size() | ( ( values[idx].empty() ? 0x00 : fixedTypes[idx] ) << 16 ));
+		data.insert(data.end(), values[idx].begin(), values[idx].end());
+	}
+	for (auto& f : tmpl.fields)
+	{
+		MakeBenchValue(fieldValue, f.type, rnd, options);
+		descriptors.push_back(fieldValue.size() | ( f.type << 16 ));
+		data.insert(data.end(), fieldValue.begin(), fieldValue.end());
+	}
+
+	w.PutValue<uint32_t>(descriptors.size());
+	w.Put(&descriptors[0], descriptors.size() * sizeof(descriptors[0]));
+	w.Put(&data[0], data.size());
+	w.PutValue<uint8_t>(0x00);
+
+	uint32_t	size	=	w.Pos() - recordStart + sizeof(uint32_t);
+
+	w.PutValue<uint32_t>(size);
+	w.Patch<uint32_t>(recordStart + 4, size);
+}
+
+/*  A complete file: the header and numChunks full chunks with valid checksums */
+std::vector<uint8_t>	MakeCorpus(const CorpusOptions& options, uint64_t* numRecords)
+{
+	BenchRandom			rnd(options.seed);
+	std::vector<BenchTemplate>	templates	=	MakeBenchTemplates(rnd, options);
+	std::vector<uint8_t>		corpus(sizeof(EvtxHeader), 0);
+	uint64_t			number		=	1;
+
+	for (uint32_t chunkIdx = 0; chunkIdx < options.numChunks; chunkIdx++)
+	{
+		ChunkWriter	w;
+		uint64_t	firstRecord	=	number;
+		uint32_t	lastRecordOffset =	sizeof(EvtxChunkHeader);
+
+		while ( 1 )
+		{
+			const BenchTemplate&	tmpl	=	templates[rnd.Below(templates.size())];
+			size_t			start	=	w.Pos();
+			std::map<std::string, uint32_t>	savedNames	=	w.names;
+			std::map<uint32_t, uint32_t>	savedTemplates	=	w.templates;
+
+			WriteBenchRecord(w, tmpl, number, rnd, options);
+			if ( w.Pos() > EVTX_CHUNK_SIZE )
+			{
+				/*  does not fit, the chunk is full */
+				w.buf.resize(start);
+				w.names.swap(savedNames);
+				w.templates.swap(savedTemplates);
+				break;
+			}
+			lastRecordOffset = start;
+			number++;
+		}
+
+		EvtxChunkHeader	header;
+		uint32_t	freeSpace	=	w.Pos();
+
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, EVTX_CHUNK_HEADER_MAGIC, sizeof(EVTX_CHUNK_HEADER_MAGIC));
+		header.firstRecordNumber = header.firstRecordNumber2 = firstRecord;
+		header.lastRecordNumber = header.lastRecordNumber2 = number - 1;
+		header.chunkHeaderSize = 0x80;
+		header.lastRecordOffset = lastRecordOffset;
+		header.freeSpaceOffset = freeSpace;
+		w.buf.resize(EVTX_CHUNK_SIZE, 0);
+		header.recordsChecksum = Crc32(0, &w.buf[sizeof(header)], freeSpace - sizeof(header));
+		memcpy(&w.buf[0], &header, sizeof(header));
+		header.checksum = Crc32(0, &w.buf[0], 0x78);
+		header.checksum = Crc32(header.checksum, &w.buf[0x80], sizeof(header) - 0x80);
+		memcpy(&w.buf[0], &header, sizeof(header));
+
+		corpus.insert(corpus.end(), w.buf.begin(), w.buf.end());
+	}
+
+	EvtxHeader	header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVTX_HEADER_MAGIC, sizeof(EVTX_HEADER_MAGIC));
+	header.firstChunkNumber = 0;
+	header.lastChunkNumber = options.numChunks ? options.numChunks - 1 : 0;
+	header.nextRecordNumber = number;
+	header.headerSize = 0x80;
+	header.version = 0x00030001;
+	header.headerBlockSize = sizeof(EvtxHeader);
+	header.numberOfChunks = options.numChunks;
+	header.checksum = Crc32(0, (const uint8_t*)&header, 0x78);
+	memcpy(&corpus[0], &header, sizeof(header));
+
+	*numRecords = number - 1;
+	return corpus;
+}
+
+uint64_t	CountRecords(const std::vector<uint8_t>& corpus)
+{
+	uint64_t	numRecords	=	0;
+
+	for (uint64_t off = sizeof(EvtxHeader); off + EVTX_CHUNK_SIZE <= corpus.size(); off += EVTX_CHUNK_SIZE)
+	{
+		const uint8_t*	chunk	=	&corpus[off];
+		uint64_t	inChunk	=	sizeof(EvtxChunkHeader);
+
+		if ( memcmp(chunk, EVTX_CHUNK_HEADER_MAGIC, sizeof(EVTX_CHUNK_HEADER_MAGIC)) )
+			break;
+		while ( inChunk + sizeof(EvtxRecordHeader) <= EVTX_CHUNK_SIZE )
+		{
+			const EvtxRecordHeader*	record	=	reinterpret_cast<const EvtxRecordHeader*>(chunk + inChunk);
+
+			if ( record->magic != 0x00002a2a || record->size < sizeof(*record) )
+				break;
+			numRecords++;
+			inChunk += record->size;
+		}
+	}
+
+	return numRecords;
+}
+
+struct BenchStage {
+	const char*	name;
+	EvtxFormat	format;
+	bool		headersOnly;	/*  every record is rejected by its header */
+	bool		indexing;	/*  the records are parsed up to the EventID */
+	bool		verifying;	/*  --verify, the chunk checksums are checked first */
+};
+
+static const BenchStage	benchStages[]	=	{
+	{ "headers",	EvtxFormatRaw,		true,	false,	false },
+	{ "verify",	EvtxFormatRaw,		true,	false,	true },
+	{ "index",	EvtxFormatRaw,		false,	true,	false },
+	{ "raw",	EvtxFormatRaw,		false,	false,	false },
+	{ "jsonl",	EvtxFormatJsonLines,	false,	false,	false },
+	{ "csv",	EvtxFormatCsv,		false,	false,	false },
+	{ "arrow",	EvtxFormatArrow,	false,	false,	false },
+};
+
+/*  Best time of all iterations; the allocations are counted in the last one, when the worker is warm */
+void	RunStage(const BenchStage& stage, const std::vector<uint8_t>& corpus, uint64_t numRecords, unsigned iterations)
+{
+	RecordFilter	filter;
+	TemplateCache	templateCache;
+	WorkerContext	worker(stage.format, &filter);
+	double		best		=	1e30;
+	uint64_t	allocations	=	0;
+	uint64_t	outputBytes	=	0;
+	FILE*		arrowSink	=	( stage.format == EvtxFormatArrow ) ? tmpfile() : NULL;	/*  the batches are written too */
+
+	if ( stage.headersOnly )
+		filter.since = UINT64_MAX;
+	worker.indexing = stage.indexing;
+	worker.verifying = stage.verifying;
+	worker.templateCache = &templateCache;
+
+	for (unsigned iteration = 0; iteration < iterations; iteration++)
+	{
+		uint64_t	allocationsBefore	=	numAllocations;
+		auto		start			=	std::chrono::steady_clock::now();
+		std::unique_ptr<ArrowBatchWriter>	arrow;
+
+		outputBytes = 0;
+		if ( arrowSink != NULL )
+		{
+			rewind(arrowSink);
+			arrow.reset(new ArrowBatchWriter(arrowSink));
+		}
+		for (uint64_t off = sizeof(EvtxHeader); off + EVTX_CHUNK_SIZE <= corpus.size(); off += EVTX_CHUNK_SIZE)
+		{
+			if ( ParseChunk(&worker, &corpus[off], EVTX_CHUNK_SIZE, off) != ChunkParsed )
+				break;
+			if ( arrow )
+				arrow->Append(worker.out.Data(0), worker.out.Size());
+			else
+				outputBytes += worker.out.Size();
+			worker.out.Clear();
+		}
+		if ( arrow )
+		{
+			arrow->Finish();
+			fflush(arrowSink);
+			outputBytes = ftell(arrowSink);
+		}
+
+		std::chrono::duration<double>	elapsed	=	std::chrono::steady_clock::now() - start;
+
+		best = std::min(best, elapsed.count());
+		allocations = numAllocations - allocationsBefore;
+	}
+
+	printf("%-10s %10.4f %14.0f %10.1f %12.3f %10.1f\n",
+		stage.name,
+		best,
+		numRecords / best,
+		corpus.size() / best / ( 1024 * 1024 ),
+		numRecords ? (double)allocations / numRecords : 0.0,
+		outputBytes / best / ( 1024 * 1024 ));
+	if ( arrowSink != NULL )
+		fclose(arrowSink);
+}
+
+/*  One pass with an empty TemplateCache: a template is parsed in the first chunk that has it, then taken from the cache
+ *  in every other one wherever its names are in the chunk, so the definitions parsed are about the distinct templates */
+void	CountTemplateDefinitions(const std::vector<uint8_t>& corpus)
+{
+#if defined(PARSE_EVTX_STATS)
+	RecordFilter	filter;
+	TemplateCache	templateCache;
+	WorkerContext	worker(EvtxFormatRaw, &filter);
+
+	worker.templateCache = &templateCache;
+	for (uint64_t off = sizeof(EvtxHeader); off + EVTX_CHUNK_SIZE <= corpus.size(); off += EVTX_CHUNK_SIZE)
+	{
+		if ( ParseChunk(&worker, &corpus[off], EVTX_CHUNK_SIZE, off) != ChunkParsed )
+			break;
+		worker.out.Clear();
+	}
+	printf("templates: %" PRIu64 " definitions parsed, %" PRIu64 " taken from earlier chunks\n",
+		worker.stats.templateMisses, worker.stats.templateCacheHits);
+#endif
+}
+
+bool	ReadWholeFile(const char* fileName, std::vector<uint8_t>& data)
+{
+	FILE*	f	=	fopen(fileName, "rb");
+	uint8_t	buffer[0x10000];
+	size_t	len;
+
+	if ( f == NULL )
+		return false;
+	while ( ( len = fread(buffer, 1, sizeof(buffer), f) ) > 0 )
+		data.insert(data.end(), buffer, buffer + len);
+	fclose(f);
+	return true;
+}
+
+bool	ParseTypeList(const char* str, std::vector<uint8_t>& types)
+{
+	types.clear();
+	while ( 1 )
+	{
+		char*		end;
+		unsigned long	type	=	strtoul(str, &end, 16);
+
+		if ( end == str || type > 0xFF )
+			return false;
+		types.push_back(type);
+		if ( *end == 0 )
+			return true;
+		if ( *end != ',' )
+			return false;
+		str = end + 1;
+	}
+}
+
+void	Usage()
+{
+	fprintf(stderr, "Usage: parse_evtx_bench [options] [file.evtx]\n"
+		"    --chunks N          chunks in the synthetic corpus (320, about 20 MB)\n"
+		"    --templates N       distinct templates (12)\n"
+		"    --string-length N   longest string value in characters (64)\n"
+		"    --types T[,T]       hex BinXml types of the EventData values (01,02,04,06,08,0A,0E,0F,11,13,14,15,81)\n"
+		"    --seed N            corpus seed (1)\n"
+		"    --iterations N      runs of every stage, the best one is reported (5)\n"
+		"    --write FILE        write the corpus to FILE and exit\n"
+		"A file given on the command line is benchmarked instead of the synthetic corpus.\n");
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	CorpusOptions		options;
+	unsigned		iterations	=	5;
+	const char*		writeName	=	NULL;
+	const char*		inputName	=	NULL;
+	std::vector<uint8_t>	corpus;
+	uint64_t		numRecords;
+
+	for (int idx = 1; idx < argc; idx++) {
+		const char*	value	=	( idx + 1 < argc ) ? argv[idx + 1] : NULL;
+
+		if ( argv[idx][0] != '-' ) {
+			inputName = argv[idx];
+			continue;
+		}
+		if ( value == NULL ) {
+			Usage();
+			return 1;
+		}
+		idx++;
+		if ( !strcmp(argv[idx - 1], "--chunks") )
+			options.numChunks = strtoul(value, NULL, 10);
+		else if ( !strcmp(argv[idx - 1], "--templates") )
+			options.numTemplates = std::max(1UL, strtoul(value, NULL, 10));
+		else if ( !strcmp(argv[idx - 1], "--string-length") )
+			options.maxStringLength = std::min(4000UL, strtoul(value, NULL, 10));
+		else if ( !strcmp(argv[idx - 1], "--seed") )
+			options.seed = strtoull(value, NULL, 10);
+		else if ( !strcmp(argv[idx - 1], "--iterations") )
+			iterations = std::max(1UL, strtoul(value, NULL, 10));
+		else if ( !strcmp(argv[idx - 1], "--write") )
+			writeName = value;
+		else if ( !strcmp(argv[idx - 1], "--types") ) {
+			if ( !ParseTypeList(value, options.types) ) {
+				Usage();
+				return 1;
+			}
+		} else {
+			Usage();
+			return 1;
+		}
+	}
+
+	if ( inputName != NULL ) {
+		if ( !ReadWholeFile(inputName, corpus) ) {
+			fprintf(stderr, "Could not read %s\n", inputName);
+			return 1;
+		}
+		numRecords = CountRecords(corpus);
+	} else {
+		corpus = MakeCorpus(options, &numRecords);
+	}
+
+	if ( writeName != NULL ) {
+		FILE*	f	=	fopen(writeName, "wb");
+
+		if ( f == NULL || fwrite(&corpus[0], 1, corpus.size(), f) != corpus.size() || fclose(f) != 0 ) {
+			fprintf(stderr, "Could not write %s\n", writeName);
+			return 1;
+		}
+		return 0;
+	}
+
+	printf("corpus: %.1f MB, %" PRIu64 " records\n", corpus.size() / ( 1024.0 * 1024.0 ), numRecords);
+	printf("%-10s %10s %14s %10s %12s %10s\n", "stage", "seconds", "records/s", "MB/s", "allocs/rec", "out MB/s");
+	for (size_t idx = 0; idx < countof(benchStages); idx++)
+		RunStage(benchStages[idx], corpus, numRecords, iterations);
+	CountTemplateDefinitions(corpus);
+
+	return 0;
+}
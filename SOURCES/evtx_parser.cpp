@@ -0,0 +1,6081 @@
+/*
+ * =====================================================================================
+ *       Filename:  evtx_parser.cpp
+ *    Description:  Parse EVTX format files, the library behind parse_evtx
+ *        Created:  09.01.2018 16:59:43
+ *         Author:  Igor Kuznetsov (igosha)
+ *         igosha@kaspersky.com
+ *         2igosha@gmail.com
+ * =====================================================================================
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "win_types.h"
+#include <sys/stat.h>
+#ifndef S_ISDIR
+#define S_ISDIR(m)	( ( (m) & S_IFMT ) == S_IFDIR )
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <dirent.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#ifndef PARSE_EVTX_NO_IO_URING
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#define PARSE_EVTX_IO_URING
+#endif
+#endif
+#include <unordered_map>
+#include <vector>
+#include <map>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include "eventlist.h"
+#include "evtx_parser.h"
+#ifdef PARSE_EVTX_ZLIB
+#include <zlib.h>
+#endif
+#ifdef PARSE_EVTX_ZSTD
+#include <zstd.h>
+#endif
+#ifdef PARSE_EVTX_LZ4
+#include <lz4frame.h>
+#endif
+
+/*  --verify: carry-less multiplication on x86 if the CPU has it, the CRC32 instructions on ARMv8 if built for them.
+ *  The SSE4.2 crc32 instruction is no use, it computes CRC32C and the checksums are zlib's CRC32 */
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define EVTX_CRC32_CLMUL	1
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define EVTX_CRC32_ARM		1
+#include <arm_acle.h>
+#endif
+
+// #define PRINT_TAGS
+
+/*  --stats counters, -DPARSE_EVTX_NO_STATS compiles them out */
+#if !defined(PARSE_EVTX_NO_STATS)
+#define PARSE_EVTX_STATS	1
+#endif
+
+#include "wintime.h"
+#include "utf16.h"
+#include "arrow_ipc.h"
+
+namespace {
+
+#pragma pack(push, 1)
+
+#define EVTX_HEADER_MAGIC	"ElfFile"
+
+typedef struct
+{
+	char		magic[8];
+	uint64_t	firstChunkNumber;
+	uint64_t	lastChunkNumber;	/*  lower than the first one once the file wrapped around */
+	uint64_t	nextRecordNumber;
+	uint32_t	headerSize;
+	uint32_t	version;
+	uint16_t	headerBlockSize;
+	uint16_t	numberOfChunks;
+	uint8_t		reserved[0x78 - 0x2C];
+	uint32_t	flags;
+	uint32_t	checksum;
+	uint8_t		reserved2[0x1000 - 0x80];
+}
+EvtxHeader;
+
+#define EVTX_CHUNK_HEADER_MAGIC	"ElfChnk"
+
+typedef struct
+{
+	char		magic[8];
+	uint64_t	firstRecordNumber;
+	uint64_t	lastRecordNumber;
+	uint64_t	firstRecordNumber2;
+	uint64_t	lastRecordNumber2;
+	uint32_t	chunkHeaderSize;
+	uint32_t	lastRecordOffset;
+	uint32_t	freeSpaceOffset;
+	uint32_t	recordsChecksum;	/*  CRC32 of the records, from the end of the header to freeSpaceOffset */
+	uint8_t		reserved[0x78 - 0x38];
+	uint32_t	flags;
+	uint32_t	checksum;		/*  CRC32 of the first 0x78 bytes and of the string and template tables */
+	uint32_t	stringTable[64];
+	uint32_t	templateTable[32];
+}
+EvtxChunkHeader;
+
+#define EVTX_CHUNK_SIZE		0x10000
+
+typedef struct
+{
+	uint32_t	magic;
+	uint32_t	size;
+	uint64_t	number;
+	uint64_t	timestamp;
+}
+EvtxRecordHeader;
+
+
+typedef struct
+{
+	uint32_t	d1;
+	uint16_t	w1;
+	uint16_t	w2;
+	uint8_t		b1[8];
+}
+EvtxGUID;
+
+#define EVTX_INDEX_MAGIC	"EvtxIdx"
+#define EVTX_INDEX_VERSION	2
+#define EVTX_INDEX_SUFFIX	".idx"
+
+/*  Sidecar file written by --build-index: this header and one entry per parsed chunk */
+typedef struct
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	numChunks;
+	uint64_t	fileSize;	/*  of the .evtx file, the index is ignored if it does not match */
+	uint64_t	fileTime;
+	uint32_t	flags;		/*  EVTX_INDEX_BUILT_* */
+	uint32_t	reserved;
+}
+EvtxIndexHeader;
+
+#define EVTX_INDEX_BUILT_VERIFIED	0x00000001	/*  built with --verify, the chunks that failed have empty entries */
+
+#define EVTX_INDEX_BLOOM_BITS	512
+
+#define EVTX_INDEX_INCOMPLETE	0x00000001	/*  some record could not be parsed, never skip the chunk */
+
+typedef struct
+{
+	uint64_t	firstRecord;
+	uint64_t	lastRecord;
+	uint64_t	minTime;
+	uint64_t	maxTime;
+	uint32_t	numRecords;
+	uint32_t	flags;
+	uint8_t		eventIDs[EVTX_INDEX_BLOOM_BITS / 8];	/*  Bloom filter of the EventIDs */
+}
+EvtxIndexEntry;
+#pragma pack(pop)
+
+/*  Slicing by 8, the CRC32 register is in and out inverted */
+uint32_t	Crc32Table(uint32_t crc, const uint8_t* data, size_t len)
+{
+	static const struct Tables {
+		Tables() {
+			for (uint32_t idx = 0; idx < 256; idx++)
+			{
+				uint32_t	value	=	idx;
+
+				for (unsigned bit = 0; bit < 8; bit++)
+					value = ( value & 1 ) ? ( value >> 1 ) ^ 0xEDB88320 : value >> 1;
+				entries[0][idx] = value;
+			}
+			for (unsigned slice = 1; slice < 8; slice++)
+				for (uint32_t idx = 0; idx < 256; idx++)
+					entries[slice][idx] = ( entries[slice - 1][idx] >> 8 ) ^ entries[0][entries[slice - 1][idx] & 0xFF];
+		}
+		uint32_t	entries[8][256];
+	} tables;
+	const uint32_t	(*t)[256]	=	tables.entries;
+
+	while ( len >= 8 )
+	{
+		uint32_t	low;
+		uint32_t	high;
+
+		memcpy(&low, data, sizeof(low));
+		memcpy(&high, data + 4, sizeof(high));
+		low ^= crc;
+		crc = t[7][low & 0xFF] ^ t[6][( low >> 8 ) & 0xFF] ^ t[5][( low >> 16 ) & 0xFF] ^ t[4][low >> 24] ^
+			t[3][high & 0xFF] ^ t[2][( high >> 8 ) & 0xFF] ^ t[1][( high >> 16 ) & 0xFF] ^ t[0][high >> 24];
+		data += 8;
+		len -= 8;
+	}
+	while ( len-- > 0 )
+		crc = t[0][( crc ^ *data++ ) & 0xFF] ^ ( crc >> 8 );
+	return crc;
+}
+
+#if defined(EVTX_CRC32_CLMUL)
+/*  Folding by 4x128 bits then Barrett reduction, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ"
+ *  with the bit-reflected constants of the zlib polynomial. len is at least 64 and a multiple of 16 */
+__attribute__((target("pclmul,sse4.1")))
+uint32_t	Crc32Clmul(uint32_t crc, const uint8_t* data, size_t len)
+{
+	const __m128i	k1k2	=	_mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+	const __m128i	k3k4	=	_mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+	const __m128i	k5k0	=	_mm_set_epi64x(0, 0x0163cd6124LL);
+	const __m128i	poly	=	_mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+	const __m128i	mask32	=	_mm_setr_epi32(~0, 0, ~0, 0);
+	__m128i		x1	=	_mm_xor_si128(_mm_loadu_si128((const __m128i*)data), _mm_cvtsi32_si128(crc));
+	__m128i		x2	=	_mm_loadu_si128((const __m128i*)( data + 0x10 ));
+	__m128i		x3	=	_mm_loadu_si128((const __m128i*)( data + 0x20 ));
+	__m128i		x4	=	_mm_loadu_si128((const __m128i*)( data + 0x30 ));
+	__m128i		x5;
+
+	data += 64;
+	len -= 64;
+	while ( len >= 64 )
+	{
+		x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i*)data));
+		x5 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		x2 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i*)( data + 0x10 )));
+		x5 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		x3 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i*)( data + 0x20 )));
+		x5 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+		x4 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x5), _mm_loadu_si128((const __m128i*)( data + 0x30 )));
+		data += 64;
+		len -= 64;
+	}
+
+	/*  4x128 to 128 bits, then the blocks of 16 left */
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+	while ( len >= 16 )
+	{
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128((const __m128i*)data)), x5);
+		data += 16;
+		len -= 16;
+	}
+
+	/*  128 to 64 bits */
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00), x2);
+
+	/*  Barrett reduction to 32 bits */
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return _mm_extract_epi32(x1, 1);
+}
+#endif
+
+#if defined(EVTX_CRC32_ARM)
+uint32_t	Crc32Arm(uint32_t crc, const uint8_t* data, size_t len)
+{
+	while ( len >= 8 )
+	{
+		uint64_t	value;
+
+		memcpy(&value, data, sizeof(value));
+		crc = __crc32d(crc, value);
+		data += 8;
+		len -= 8;
+	}
+	while ( len-- > 0 )
+		crc = __crc32b(crc, *data++);
+	return crc;
+}
+#endif
+
+/*  The CRC32 of zlib, as used by the file and chunk checksums; crc is the result for the data before */
+uint32_t	Crc32(uint32_t crc, const uint8_t* data, size_t len)
+{
+	crc = ~crc;
+#if defined(EVTX_CRC32_CLMUL)
+	static const bool	haveClmul	=	__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+
+	if ( haveClmul && len >= 64 )
+	{
+		size_t	blocksLen	=	len & ~(size_t)15;
+
+		crc = Crc32Clmul(crc, data, blocksLen);
+		data += blocksLen;
+		len -= blocksLen;
+	}
+#elif defined(EVTX_CRC32_ARM)
+	return ~Crc32Arm(crc, data, len);
+#endif
+	return ~Crc32Table(crc, data, len);
+}
+
+static_assert(sizeof(EvtxHeader) == 0x1000, "EvtxHeader layout");
+static_assert(sizeof(EvtxChunkHeader) == 0x200, "EvtxChunkHeader layout");
+
+void	ResetIndexEntry(EvtxIndexEntry* entry)
+{
+	memset(entry, 0, sizeof(*entry));
+	entry->firstRecord = entry->minTime = UINT64_MAX;
+}
+
+void	IndexEntryAddRecord(EvtxIndexEntry* entry, uint64_t number, uint64_t timestamp)
+{
+	entry->numRecords++;
+	entry->firstRecord = std::min(entry->firstRecord, number);
+	entry->lastRecord = std::max(entry->lastRecord, number);
+	entry->minTime = std::min(entry->minTime, timestamp);
+	entry->maxTime = std::max(entry->maxTime, timestamp);
+}
+
+/*  Two bits per EventID */
+void	IndexEntryBloomBits(uint16_t eventID, uint32_t* bit1, uint32_t* bit2)
+{
+	*bit1 = ( eventID * 0x9E3779B1U ) >> ( 32 - 9 );
+	*bit2 = ( eventID * 0x85EBCA77U ) >> ( 32 - 9 );
+}
+
+void	IndexEntryAddEventID(EvtxIndexEntry* entry, uint16_t eventID)
+{
+	uint32_t	bit1, bit2;
+
+	IndexEntryBloomBits(eventID, &bit1, &bit2);
+	entry->eventIDs[bit1 >> 3] |= 1 << ( bit1 & 7 );
+	entry->eventIDs[bit2 >> 3] |= 1 << ( bit2 & 7 );
+}
+
+bool	IndexEntryMayHaveEventID(const EvtxIndexEntry* entry, uint16_t eventID)
+{
+	uint32_t	bit1, bit2;
+
+	IndexEntryBloomBits(eventID, &bit1, &bit2);
+	return ( entry->eventIDs[bit1 >> 3] & ( 1 << ( bit1 & 7 ) ) ) && ( entry->eventIDs[bit2 >> 3] & ( 1 << ( bit2 & 7 ) ) );
+}
+
+typedef enum
+{
+	StateNormal		=	1,
+	StateInAttribute	=	2,
+}
+XmlParseState;
+
+struct TemplateDescription;
+struct WorkerContext;
+
+struct ParseContext {
+	ParseContext*	chunkContext;
+	WorkerContext*	worker;
+	const uint8_t*	data;
+	uint64_t    dataLen;
+	uint64_t    offset;
+	uint64_t    offsetFromChunkStart;
+	XmlParseState	state;
+	TemplateDescription* currentTemplatePtr;
+	const char*	cachedValue;	/*  the last text value, in the chunk arena, so copying a context stays cheap */
+
+	bool	HaveEnoughData(uint64_t numBytes) const {
+		return ( offset + numBytes <= dataLen );
+	}
+
+	void	SkipBytes(uint64_t numBytes) {
+		offset += numBytes;
+	}
+
+	template<class c>
+	bool	ReadData(c* result, uint64_t count = 1)
+	{
+		if ( !HaveEnoughData(sizeof(*result) * count) )
+			return false;
+		for (uint64_t idx = 0; idx < count; idx++)
+		{
+			result[idx] = *(c*)(data + offset);
+			offset += sizeof(*result);
+		}
+		return true;
+	}
+
+	void InheritWithOffset(ParseContext* other, uint64_t wantedLen) {
+		data = other->data + other->offset;
+		dataLen = wantedLen;
+		if ( other->offset + dataLen > other->dataLen ) {
+			/*  invalid len specified, fix it */
+			if ( other->offset >= other->dataLen ) {
+				dataLen = 0; /* out of all bounds */
+			} else {
+				dataLen = other->dataLen - other->offset;
+#if defined(PRINT_TAGS)
+				printf("cap on wantedLen %08zX (%08zX), want %08zX, give %08zX\n", other->offset, other->offset, wantedLen, dataLen);
+#endif
+			}
+		}
+		offset = 0;
+		chunkContext = other;
+		worker = other->worker;
+		offsetFromChunkStart = other->offset + other->offsetFromChunkStart;
+		cachedValue = "";
+	}
+
+	void UpdateLen(uint64_t wantedLen){
+		if ( wantedLen <= dataLen ) {
+			dataLen = wantedLen;
+		}
+	}
+};
+
+bool	ParseBinXml(ParseContext* ctx, uint64_t chunkOffsetInFile);
+
+#define NUM_EVENT_DESCRIPTIONS	( sizeof(eventDescriptions) / sizeof(eventDescriptions[0]) )
+
+constexpr bool	EventDescriptionsSorted(size_t idx)
+{
+	return idx + 1 >= NUM_EVENT_DESCRIPTIONS ||
+		( eventDescriptions[idx].eventID < eventDescriptions[idx + 1].eventID && EventDescriptionsSorted(idx + 1) );
+}
+
+static_assert(EventDescriptionsSorted(0), "eventlist.h has to be sorted by EventID");
+
+const char*	logonTypes[]	= { NULL, NULL, "Interactive", "Network", "Batch", "Service", NULL, "Unlock", "NetworkCleartext", "NewCredentials", "RemoteInteractive", "CachedInteractive"};
+
+/*  A binary search in the constant table, nothing to build at startup */
+const EventDescription*	GetEventDescription(uint16_t eventID)
+{
+	size_t	lo	=	0;
+	size_t	hi	=	NUM_EVENT_DESCRIPTIONS;
+
+	if ( eventID < eventDescriptions[0].eventID || eventID > eventDescriptions[NUM_EVENT_DESCRIPTIONS - 1].eventID )
+		return NULL;
+	while ( lo < hi )
+	{
+		size_t	mid	=	( lo + hi ) / 2;
+
+		if ( eventDescriptions[mid].eventID < eventID )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return ( lo < NUM_EVENT_DESCRIPTIONS && eventDescriptions[lo].eventID == eventID ) ? &eventDescriptions[lo] : NULL;
+}
+
+/*  Keys whose values get an explanation appended, resolved once when the template is registered */
+typedef enum
+{
+	KeyPlain	=	0,
+	KeyEventID	=	1,
+	KeyLogonType	=	2,
+	KeyAddress	=	3,
+}
+KeyClass;
+
+KeyClass	ClassifyKey(const char* key)
+{
+	if ( !strcmp(key, "EventID") )
+		return KeyEventID;
+	if ( !strcmp(key, "LogonType") )
+		return KeyLogonType;
+	if ( !strcmp(key, "Address1") || !strcmp(key, "Address2") )
+		return KeyAddress;
+	return KeyPlain;
+}
+
+#define ARENA_BLOCK_SIZE	0x10000
+#define ARENA_ALIGNMENT		8
+
+/*  Bump allocator for everything that lives until the end of a chunk.
+ *  Reset() just rewinds, the blocks are kept for the next chunk */
+class Arena {
+public:
+	Arena() : current(0), used(0) {}
+
+	void*	Alloc(size_t size) {
+		void*	result;
+
+		size = ( size + ARENA_ALIGNMENT - 1 ) & ~(size_t)( ARENA_ALIGNMENT - 1 );
+		if ( blocks.empty() || used + size > blocks[current].size )
+			NextBlock(size);
+		result = blocks[current].data.get() + used;
+		used += size;
+		return result;
+	}
+
+	const char*	Strdup(const char* str, size_t len) {
+		char*	result	=	(char*)Alloc(len + 1);
+
+		memcpy(result, str, len);
+		result[len] = 0;
+		return result;
+	}
+
+	void	Reset() {
+		current = 0;
+		used = 0;
+	}
+
+private:
+	struct Block {
+		Block(size_t blockSize) : data(new uint8_t[blockSize]), size(blockSize) {}
+		std::unique_ptr<uint8_t[]>	data;
+		size_t				size;
+	};
+
+	void	NextBlock(size_t size) {
+		size_t	next	=	blocks.empty() ? 0 : current + 1;
+
+		while ( next < blocks.size() && blocks[next].size < size )
+			next++;
+		if ( next >= blocks.size() )
+		{
+			blocks.push_back(Block(std::max(size, (size_t)ARENA_BLOCK_SIZE)));
+			next = blocks.size() - 1;
+		}
+		current = next;
+		used = 0;
+	}
+
+	std::vector<Block>	blocks;
+	size_t			current;
+	size_t			used;
+};
+
+/*  Lets standard containers live in an arena, memory is only given back by Arena::Reset() */
+template<class T>
+class ArenaAllocator {
+public:
+	typedef T	value_type;
+
+	ArenaAllocator(Arena* owner) : arena(owner) {}
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T*	allocate(size_t count) {
+		return static_cast<T*>(arena->Alloc(count * sizeof(T)));
+	}
+
+	void	deallocate(T*, size_t) {}
+
+	template<class U>
+	bool	operator==(const ArenaAllocator<U>& other) const {
+		return arena == other.arena;
+	}
+
+	template<class U>
+	bool	operator!=(const ArenaAllocator<U>& other) const {
+		return arena != other.arena;
+	}
+
+	Arena*	arena;
+};
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/*  One slot of the argument layout, key == nullptr means the template does not use the argument */
+struct TemplateArgPair {
+	TemplateArgPair() : key(nullptr), keyLen(0), keyClass(KeyPlain), type(0) {}
+	TemplateArgPair(Arena* arena, const char* ekey, uint16_t etype){
+		keyLen = strlen(ekey);
+		key = arena->Strdup(ekey, keyLen);
+		keyClass = ClassifyKey(key);
+		type = etype;
+	}
+	const char*		key;
+	size_t			keyLen;
+	KeyClass		keyClass;
+	uint16_t		type;
+};
+
+struct TemplateFixedPair {
+	TemplateFixedPair(Arena* arena, const char* ekey, const char* evalue) {
+		keyLen = strlen(ekey);
+		key = arena->Strdup(ekey, keyLen);
+		valueLen = strlen(evalue);
+		value = arena->Strdup(evalue, valueLen);
+		keyClass = ClassifyKey(key);
+		eventID = 0;
+		eventDescription = NULL;
+		projected = true;
+		if ( keyClass == KeyEventID )
+		{
+			eventID = strtoul(value, NULL, 10);
+			if ( eventID != 0 )
+				eventDescription = GetEventDescription(eventID);
+		}
+	}
+	const char*		key;
+	size_t			keyLen;
+	const char*		value;
+	size_t			valueLen;
+	KeyClass		keyClass;
+	uint16_t		eventID;
+	const EventDescription*	eventDescription;	/*  printed as a number with the description when set */
+	bool			projected;		/*  not left out by --fields */
+};
+
+/*  Prints one substitution value and consumes it, false if the record is too short */
+typedef bool	(*ArgumentFormatter)(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen);
+
+/*  What CompileTemplate() made of one argument: argPair == NULL skips it, format expects a value of type */
+struct TemplateOp {
+	TemplateOp() : format(NULL), argPair(NULL), type(0) {}
+	ArgumentFormatter	format;
+	const TemplateArgPair*	argPair;
+	uint16_t		type;
+};
+
+/*  --format=xml: a substitution in the XML of a template. An attribute that is nothing but the value has its name
+ *  at textPos, nameLen long, and is left out where the value is null */
+struct TemplateXmlSlot {
+	uint32_t	textPos;
+	uint16_t	nameLen;
+	uint16_t	argIdx;
+};
+
+/*  Lives in the chunk arena together with all its keys and values, it is never destroyed */
+struct TemplateDescription {
+	TemplateDescription(Arena* owner) : shortID(0), arena(owner), fixed(owner), args(owner), renderedFixed(owner), fixedRendered(false), program(owner), compiled(false),
+		xmlText(owner), xmlSlots(owner) {}
+	uint32_t		shortID;
+	Arena*			arena;
+	ArenaVector<TemplateFixedPair>		fixed;
+	ArenaVector<TemplateArgPair>		args;	/*  indexed by the substitution ID */
+	ArenaVector<char>			renderedFixed;	/*  output of all the fixed pairs, valid if fixedRendered */
+	bool					fixedRendered;
+	ArenaVector<TemplateOp>			program;	/*  one op per argument, valid if compiled */
+	bool					compiled;
+	ArenaVector<char>			xmlText;	/*  --format=xml: the template's XML around the slots */
+	ArenaVector<TemplateXmlSlot>		xmlSlots;
+
+	void	RegisterFixedPair(const char* key, const char* value) {
+		fixed.emplace_back(TemplateFixedPair(arena, key, value));
+		fixedRendered = false;
+		compiled = false;
+	}
+
+	void	RegisterArgPair(const char* key, uint16_t type, uint16_t argIdx) {
+		compiled = false;
+		if ( argIdx >= args.size() )
+			args.resize(argIdx + 1);
+		if ( args[argIdx].key == nullptr )	/*  the first substitution with this ID wins */
+			args[argIdx] = TemplateArgPair(arena, key ? key : "", type);
+	}
+
+	const TemplateArgPair*	GetArgPair(uint64_t argIdx) const {
+		if ( argIdx >= args.size() || args[argIdx].key == nullptr )
+			return nullptr;
+		return &args[argIdx];
+	}
+
+	/*  The keys and values are duplicated into our arena with copyStrings, otherwise they are shared with other */
+	void	CopyFrom(const TemplateDescription& other, bool copyStrings) {
+		fixed.assign(other.fixed.begin(), other.fixed.end());
+		args.assign(other.args.begin(), other.args.end());
+		renderedFixed.clear();
+		fixedRendered = false;
+		program.clear();
+		compiled = false;
+		xmlText.assign(other.xmlText.begin(), other.xmlText.end());
+		xmlSlots.assign(other.xmlSlots.begin(), other.xmlSlots.end());
+		if ( !copyStrings )
+			return;
+		for (auto& f : fixed)
+		{
+			f.key = arena->Strdup(f.key, f.keyLen);
+			f.value = arena->Strdup(f.value, f.valueLen);
+		}
+		for (auto& a : args)
+		{
+			if ( a.key != nullptr )
+				a.key = arena->Strdup(a.key, a.keyLen);
+		}
+	}
+
+};
+
+#define countof(arr) ( sizeof(arr) / sizeof(*arr) )
+
+#define MAX_NAME_STACK_DEPTH	20
+#define INVALID_STACK_DEPTH 	((ssize_t)-1)
+
+// Current time 2 m 20 sec
+constexpr unsigned maxNameStackDepth = 20;
+class NameStack {
+public:
+	NameStack() : nameStack(maxNameStackDepth), nameStackPtr(INVALID_STACK_DEPTH) {}
+
+	void Reset() {
+		nameStackPtr = INVALID_STACK_DEPTH;
+	}
+
+	/*  The name must stay valid until Reset(), names come from the chunk's NameCache */
+	void	PushName(const char* name) {
+		if ( nameStackPtr + 1 >= MAX_NAME_STACK_DEPTH )
+			return;
+		nameStackPtr++;
+		nameStack[nameStackPtr] = name;
+	}
+
+	void	PopName(void) {
+		if ( nameStackPtr > INVALID_STACK_DEPTH )
+			nameStackPtr--;
+	}
+
+	const char* GetName() const {
+		if ( nameStackPtr <= INVALID_STACK_DEPTH || nameStackPtr >= MAX_NAME_STACK_DEPTH )
+			return NULL;
+		return nameStack[nameStackPtr];
+	}
+
+	const char* GetUpperName() const {
+		if ( nameStackPtr <= INVALID_STACK_DEPTH || nameStackPtr >= MAX_NAME_STACK_DEPTH )
+			return NULL;
+		if ( nameStackPtr < 1 )
+			return NULL;
+
+		return nameStack[nameStackPtr - 1];
+	}
+
+private:
+	std::vector<const char*> nameStack;
+	ssize_t		nameStackPtr;
+};
+
+#define CHUNK_TABLE_SLOTS_INITIAL	64
+
+/*  Open addressing table keyed by a chunk-relative offset or ID. Reset() bumps the generation
+ *  instead of clearing the slots, the values are expected to live in the chunk arena */
+template<class V>
+class ChunkHashTable {
+public:
+	ChunkHashTable() : slots(CHUNK_TABLE_SLOTS_INITIAL), numUsed(0), generation(1) {}
+
+	bool	Find(uint32_t key, V* result) const {
+		size_t	mask	=	slots.size() - 1;
+
+		for (size_t idx = Hash(key) & mask; ; idx = ( idx + 1 ) & mask)
+		{
+			const Slot&	slot	=	slots[idx];
+
+			if ( slot.generation != generation )
+				return false;
+			if ( slot.key == key )
+			{
+				*result = slot.value;
+				return true;
+			}
+		}
+	}
+
+	void	Insert(uint32_t key, const V& value) {
+		if ( ( numUsed + 1 ) * 2 > slots.size() )
+			Grow();
+		Put(key, value);
+	}
+
+	void	Reset() {
+		numUsed = 0;
+		if ( ++generation == 0 )
+		{
+			for (auto& slot : slots)
+				slot.generation = 0;
+			generation = 1;
+		}
+	}
+
+private:
+	struct Slot {
+		Slot() : key(0), generation(0), value() {}
+		uint32_t	key;
+		uint32_t	generation;
+		V		value;
+	};
+
+	static size_t	Hash(uint32_t key) {
+		return ( key * 0x9E3779B1U ) >> 7;
+	}
+
+	void	Put(uint32_t key, const V& value) {
+		size_t	mask	=	slots.size() - 1;
+		size_t	idx	=	Hash(key) & mask;
+
+		while ( slots[idx].generation == generation && slots[idx].key != key )
+			idx = ( idx + 1 ) & mask;
+		if ( slots[idx].generation != generation )
+			numUsed++;
+		slots[idx].key = key;
+		slots[idx].generation = generation;
+		slots[idx].value = value;
+	}
+
+	void	Grow() {
+		std::vector<Slot>	old(slots.size() * 2);
+
+		old.swap(slots);
+		numUsed = 0;
+		for (auto& slot : old)
+		{
+			if ( slot.generation == generation )
+				Put(slot.key, slot.value);
+		}
+	}
+
+	std::vector<Slot>	slots;
+	size_t			numUsed;
+	uint32_t		generation;
+};
+
+/*  The templates defined in the current chunk, the descriptions live in the chunk arena */
+class Templates {
+public:
+	Templates(Arena* chunkArena) : arena(chunkArena) {}
+
+	bool	IsKnownID(uint32_t	id, TemplateDescription** result) {
+		return knownIDs.Find(id, result);
+	}
+
+	bool	RegisterID(uint32_t	id, TemplateDescription** result) {
+		TemplateDescription*	description;
+
+		description = new (arena->Alloc(sizeof(TemplateDescription))) TemplateDescription(arena);
+		description->shortID = id;
+		knownIDs.Insert(id, description);
+		*result = description;
+		return true;
+	}
+
+	void Reset() {
+		knownIDs.Reset();
+	}
+
+private:
+	Arena*					arena;
+	ChunkHashTable<TemplateDescription*>	knownIDs;
+};
+
+/*  Element and attribute names are stored once per chunk and referenced by their chunk offset,
+ *  so every name is decoded once and then served from here */
+struct CachedName {
+	CachedName() : name(NULL), charCount(0) {}
+	const char*	name;
+	uint16_t	charCount;	/*  UTF-16 length, to skip an inline definition */
+};
+
+typedef ChunkHashTable<CachedName>	NameCache;
+
+#define TEMPLATE_CACHE_MAX_ENTRIES	4096
+
+/*  Eight bytes at a time and FNV-1a for the tail */
+uint64_t	HashBytes(const uint8_t* data, uint64_t len)
+{
+	uint64_t	hash	=	0xCBF29CE484222325ULL ^ len;
+	uint64_t	word;
+	uint64_t	idx;
+
+	for (idx = 0; idx + sizeof(word) <= len; idx += sizeof(word))
+	{
+		memcpy(&word, data + idx, sizeof(word));
+		hash = ( hash ^ word ) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 32;
+	}
+	for (; idx < len; idx++)
+		hash = ( hash ^ data[idx] ) * 0x100000001B3ULL;
+	return hash;
+}
+
+/*  Templates defined by earlier chunks. The shortID is only an offset in the chunk, so they are found by
+ *  the template GUID and a hash of the definition (HashTemplateDefinition()). Shared by all the workers, an entry never
+ *  changes once added */
+class TemplateCache {
+public:
+	const TemplateDescription*	Find(const uint8_t* guid, uint64_t bodyHash) const {
+		std::lock_guard<std::mutex>	lock(cacheLock);
+		auto				found	=	entries.find(TemplateKey(guid, bodyHash));
+
+		return ( found == entries.end() ) ? NULL : found->second;
+	}
+
+	void	Insert(const uint8_t* guid, uint64_t bodyHash, const TemplateDescription& description) {
+		std::lock_guard<std::mutex>	lock(cacheLock);
+		TemplateKey			key(guid, bodyHash);
+		TemplateDescription*		copy;
+
+		if ( entries.size() >= TEMPLATE_CACHE_MAX_ENTRIES || entries.count(key) != 0 )
+			return;
+		copy = new (arena.Alloc(sizeof(TemplateDescription))) TemplateDescription(&arena);
+		copy->shortID = description.shortID;
+		copy->CopyFrom(description, true);
+		entries[key] = copy;
+	}
+
+private:
+	struct TemplateKey {
+		TemplateKey(const uint8_t* templateGuid, uint64_t templateHash) : bodyHash(templateHash) {
+			memcpy(guid, templateGuid, sizeof(guid));
+		}
+		bool	operator==(const TemplateKey& other) const {
+			return bodyHash == other.bodyHash && !memcmp(guid, other.guid, sizeof(guid));
+		}
+		uint8_t		guid[16];
+		uint64_t	bodyHash;
+	};
+
+	struct TemplateKeyHash {
+		size_t	operator()(const TemplateKey& key) const {
+			return (size_t)key.bodyHash;
+		}
+	};
+
+	Arena							arena;
+	std::unordered_map<TemplateKey, TemplateDescription*, TemplateKeyHash>	entries;
+	mutable std::mutex					cacheLock;
+};
+
+#define OUTPUT_BUFFER_INITIAL_SIZE	0x40000
+
+/*  Collects the text of one chunk so that chunks parsed concurrently can be printed in order.
+ *  All the output goes through the hand-written formatters below, the whole chunk is written with one fwrite() */
+class OutputBuffer {
+public:
+	OutputBuffer() : buffer(OUTPUT_BUFFER_INITIAL_SIZE), used(0) {}
+
+	char*	Reserve(size_t len) {
+		if ( used + len > buffer.size() )
+			buffer.resize(std::max(buffer.size() * 2, used + len));
+		return &buffer[used];
+	}
+
+	void	Commit(size_t len) {
+		used += len;
+	}
+
+	void	Append(const char* str, size_t len) {
+		memcpy(Reserve(len), str, len);
+		used += len;
+	}
+
+	void	Append(const char* str) {
+		Append(str, strlen(str));
+	}
+
+	void	Append(char c) {
+		*Reserve(1) = c;
+		used++;
+	}
+
+	/*  Same as printf("%0*u", width, value) */
+	void	AppendUnsigned(uint64_t value, unsigned width = 0) {
+		char		digits[20];
+		unsigned	len	=	0;
+		char*		p;
+
+		do {
+			digits[len++] = '0' + value % 10;
+			value /= 10;
+		} while ( value != 0 );
+
+		p = Reserve(std::max(len, width));
+		for (; width > len; width--)
+			*p++ = '0';
+		while ( len > 0 )
+			*p++ = digits[--len];
+		used = p - &buffer[0];
+	}
+
+	/*  Same as printf("%0*X", width, value) */
+	void	AppendHex(uint64_t value, unsigned width = 0) {
+		unsigned	len	=	1;
+		char*		p;
+
+		while ( len < 16 && ( value >> ( len * 4 ) ) != 0 )
+			len++;
+		if ( width < len )
+			width = len;
+		p = Reserve(width);
+		for (unsigned idx = width; idx > 0; idx--)
+		{
+			p[idx - 1] = hexDigits[value & 0x0F];
+			value >>= 4;
+		}
+		used += width;
+	}
+
+	void	AppendHexBytes(const uint8_t* data, size_t len) {
+		char*	p	=	Reserve(len * 2);
+
+		for (size_t idx = 0; idx < len; idx++)
+		{
+			*p++ = hexDigits[data[idx] >> 4];
+			*p++ = hexDigits[data[idx] & 0x0F];
+		}
+		used += len * 2;
+	}
+
+	/*  The historical %08X-%02X-%02X-%02X%02X... layout without the usual 4-4-12 grouping */
+	void	AppendGUID(const EvtxGUID& guid) {
+		AppendHex(guid.d1, 8);
+		Append('-');
+		AppendHex(guid.w1, 2);
+		Append('-');
+		AppendHex(guid.w2, 2);
+		Append('-');
+		AppendHexBytes(guid.b1, sizeof(guid.b1));
+	}
+
+	/*  'key': */
+	void	AppendKey(const char* key, size_t keyLen) {
+		Append('\'');
+		Append(key, keyLen);
+		Append("':", 2);
+	}
+
+	size_t	Size() const {
+		return used;
+	}
+
+	const char*	Data(size_t pos) const {
+		return &buffer[pos];
+	}
+
+	void	Truncate(size_t pos) {
+		if ( pos < used )
+			used = pos;
+	}
+
+	/*  What was appended at pos */
+	void	Overwrite(size_t pos, const void* data, size_t len) {
+		memcpy(&buffer[pos], data, len);
+	}
+
+	void	Flush(FILE* f) {
+		if ( used != 0 )
+			fwrite(&buffer[0], 1, used, f);
+		used = 0;
+	}
+
+	void	Clear() {
+		used = 0;
+	}
+
+private:
+	static const char	hexDigits[17];
+
+	std::vector<char>	buffer;
+	size_t			used;
+};
+
+const char	OutputBuffer::hexDigits[17]	=	"0123456789ABCDEF";
+
+/*  FILETIME to YYYY<dateSep>MM<dateSep>DD<separator>HH:MM:SS[.fraction] in UTC without gmtime_r(). The records
+ *  of a chunk are nearly in order, so the text of the last second and the date of the last day are kept */
+class TimeFormatter {
+public:
+	TimeFormatter(char dateSeparator, char timeSeparator) : dateSep(dateSeparator), separator(timeSeparator),
+		precision(EvtxTimeSeconds), lastSecond(UINT64_MAX), lastDay(UINT64_MAX), dateLen(0), textLen(0) {}
+
+	void	SetPrecision(EvtxTimePrecision timePrecision) {
+		precision = timePrecision;
+	}
+
+	void	Append(OutputBuffer& out, uint64_t fileTime) {
+		uint64_t	seconds	=	UnixTimeFromFileTime(fileTime);
+
+		if ( seconds != lastSecond )
+			Update(seconds);
+		out.Append(text, textLen);
+		if ( precision == EvtxTimeMicroseconds )
+		{
+			out.Append('.');
+			out.AppendUnsigned(fileTime % 10000000 / 10, 6);
+		}
+		else if ( precision == EvtxTime100ns )
+		{
+			out.Append('.');
+			out.AppendUnsigned(fileTime % 10000000, 7);
+		}
+	}
+
+private:
+	/*  Same as sprintf("%0*u", width, value) */
+	static char*	PutUnsigned(char* p, uint64_t value, unsigned width) {
+		char		digits[20];
+		unsigned	len	=	0;
+
+		do {
+			digits[len++] = '0' + value % 10;
+			value /= 10;
+		} while ( value != 0 );
+		for (; width > len; width--)
+			*p++ = '0';
+		while ( len > 0 )
+			*p++ = digits[--len];
+		return p;
+	}
+
+	void	Update(uint64_t seconds) {
+		uint64_t	day		=	seconds / 86400;
+		unsigned	secondOfDay	=	seconds % 86400;
+		char*		p;
+
+		if ( day != lastDay )
+		{
+			int64_t		year;
+			unsigned	month;
+			unsigned	mday;
+
+			CivilFromDays(day, &year, &month, &mday);
+			p = PutUnsigned(date, year, 4);
+			*p++ = dateSep;
+			p = PutUnsigned(p, month, 2);
+			*p++ = dateSep;
+			p = PutUnsigned(p, mday, 2);
+			dateLen = p - date;
+			lastDay = day;
+		}
+
+		memcpy(text, date, dateLen);
+		p = text + dateLen;
+		*p++ = separator;
+		p = PutUnsigned(p, secondOfDay / 3600, 2);
+		*p++ = ':';
+		p = PutUnsigned(p, secondOfDay / 60 % 60, 2);
+		*p++ = ':';
+		p = PutUnsigned(p, secondOfDay % 60, 2);
+		textLen = p - text;
+		lastSecond = seconds;
+	}
+
+	char			dateSep;
+	char			separator;
+	EvtxTimePrecision	precision;
+	uint64_t		lastSecond;
+	uint64_t		lastDay;
+	char			date[32];
+	size_t			dateLen;
+	char			text[48];
+	size_t			textLen;
+};
+
+typedef enum
+{
+	ValueString	=	1,	/*  quoted in every format */
+	ValueNumber	=	2,	/*  a bare decimal number */
+	ValueText	=	3,	/*  bare in the raw format, a string elsewhere: hex, GUIDs, SIDs, time */
+}
+ValueKind;
+
+/*  Turns the records into one of the output formats. A value is written as BeginValue(), the value
+ *  text appended straight to the buffer (escaped with AppendEscaped() if it may need it), EndValue().
+ *  Nothing is formatted into temporary strings */
+class RecordEmitter {
+public:
+	virtual ~RecordEmitter() {}
+
+	/*  timestamp is the FILETIME of the record, printed with recordTime */
+	virtual void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) = 0;
+	virtual void	EndRecord(OutputBuffer& out) = 0;
+	/*  The record could not be parsed */
+	virtual void	AbortRecord(OutputBuffer& out) = 0;
+
+	virtual void	BeginValue(OutputBuffer& out, const char* key, size_t keyLen, ValueKind kind) = 0;
+	virtual void	EndValue(OutputBuffer& out) = 0;
+	/*  Human readable explanation of the value, like the event or logon type description */
+	virtual void	BeginAnnotation(OutputBuffer& out) = 0;
+	virtual void	EndAnnotation(OutputBuffer& out) = 0;
+
+	virtual void	BeginList(OutputBuffer& out, const char* key, size_t keyLen) = 0;
+	virtual void	BeginListItem(OutputBuffer& out) = 0;
+	virtual void	EndListItem(OutputBuffer& out) = 0;
+	virtual void	EndList(OutputBuffer& out, bool itemOpen) = 0;
+
+	virtual void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) = 0;
+	/*  Zero padding for numbers, only the raw format has it */
+	virtual unsigned	NumberWidth(unsigned rawWidth) const = 0;
+	virtual void	Message(OutputBuffer& out, const char* text) = 0;
+	/*  Values don't depend on the record they are in, so a template's fixed part can be rendered once */
+	virtual bool	IsRecordIndependent() const = 0;
+	/*  Whether that text is the same here, which is always unless the output depends on the keys written so far
+	 *  in the record; NoteKeys() is told the keys of the text when it is used */
+	virtual bool	KeysUnseen(const TemplateFixedPair* pairs, size_t numPairs) {
+		return true;
+	}
+	virtual void	NoteKeys(const TemplateFixedPair* pairs, size_t numPairs) {
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str) {
+		AppendEscaped(out, str, strlen(str));
+	}
+};
+
+class RawEmitter : public RecordEmitter {
+public:
+	RawEmitter() : kind(ValueString) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		out.Append("Record #", 8);
+		out.AppendUnsigned(number);
+		out.Append(' ');
+		recordTime.Append(out, timestamp);
+		out.Append("Z ", 2);
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+		out.Append('\n');
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		/*  keep whatever was printed, as always */
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* key, size_t keyLen, ValueKind valueKind) {
+		kind = valueKind;
+		out.AppendKey(key, keyLen);
+		if ( kind == ValueString )
+			out.Append('\'');
+	}
+
+	void	EndValue(OutputBuffer& out) {
+		if ( kind == ValueString )
+			out.Append("', ", 3);
+		else
+			out.Append(", ", 2);
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		out.Append(" (", 2);
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		out.Append(')');
+	}
+
+	void	BeginList(OutputBuffer& out, const char* key, size_t keyLen) {
+		out.AppendKey(key, keyLen);
+		out.Append('[');
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		out.Append('\'');
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+		out.Append("',", 2);
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+		if ( itemOpen )
+			out.Append('\'');
+		out.Append("], ", 3);
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		out.Append(str, len);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return rawWidth;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		out.Append(text);
+	}
+
+	bool	IsRecordIndependent() const {
+		return true;
+	}
+
+private:
+	ValueKind	kind;
+};
+
+/*  Length of the valid UTF-8 sequence at str, 0 if it is not one */
+size_t	Utf8SequenceLength(const uint8_t* str, size_t len)
+{
+	uint8_t		c	=	str[0];
+	size_t		seqLen;
+	uint8_t		low	=	0x80;
+	uint8_t		high	=	0xBF;
+
+	if ( c < 0x80 )
+		return 1;
+	if ( c >= 0xC2 && c <= 0xDF )
+		seqLen = 2;
+	else if ( c >= 0xE0 && c <= 0xEF )
+		seqLen = 3;
+	else if ( c >= 0xF0 && c <= 0xF4 )
+		seqLen = 4;
+	else
+		return 0;
+	/*  no overlong forms, surrogates or code points above U+10FFFF */
+	if ( c == 0xE0 )
+		low = 0xA0;
+	else if ( c == 0xED )
+		high = 0x9F;
+	else if ( c == 0xF0 )
+		low = 0x90;
+	else if ( c == 0xF4 )
+		high = 0x8F;
+	if ( seqLen > len || str[1] < low || str[1] > high )
+		return 0;
+	for (size_t idx = 2; idx < seqLen; idx++)
+	{
+		if ( ( str[idx] & 0xC0 ) != 0x80 )
+			return 0;
+	}
+	return seqLen;
+}
+
+/*  Invalid UTF-8, which ANSI strings can have, becomes U+FFFD */
+void	AppendJsonEscaped(OutputBuffer& out, const char* str, size_t len)
+{
+	size_t	start	=	0;
+
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		uint8_t	c	=	str[idx];
+
+		if ( c >= 0x20 && c < 0x80 && c != '"' && c != '\\' )
+			continue;
+		if ( c >= 0x80 )
+		{
+			size_t	seqLen	=	Utf8SequenceLength(reinterpret_cast<const uint8_t*>(str) + idx, len - idx);
+
+			if ( seqLen != 0 )
+			{
+				idx += seqLen - 1;
+				continue;
+			}
+			out.Append(str + start, idx - start);
+			out.Append("\xEF\xBF\xBD", 3);
+			start = idx + 1;
+			continue;
+		}
+
+		out.Append(str + start, idx - start);
+		start = idx + 1;
+		switch ( c )
+		{
+		case '"':	out.Append("\\\"", 2);	break;
+		case '\\':	out.Append("\\\\", 2);	break;
+		case '\n':	out.Append("\\n", 2);	break;
+		case '\r':	out.Append("\\r", 2);	break;
+		case '\t':	out.Append("\\t", 2);	break;
+		default:
+			out.Append("\\u00", 4);
+			out.AppendHex(c, 2);
+			break;
+		}
+	}
+	out.Append(str + start, len - start);
+}
+
+#define JSON_KEY_SLOTS_INITIAL	64
+
+/*  One object per line: {"RecordNumber":1,"Timestamp":"...","key":value,...}
+ *  an annotation becomes a separate "<key>_text" member. A key seen before in the record gets the number
+ *  of the time it is seen, "Data", "Data_2", "Data_3", as JSON parsers keep only one of duplicate members */
+class JsonEmitter : public RecordEmitter {
+public:
+	JsonEmitter() : recordStart(0), key(NULL), keyLen(0), occurrence(1), kind(ValueString), valueOpen(false), firstItem(true), seenKeys(JSON_KEY_SLOTS_INITIAL), numSeen(0), generation(1) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		recordStart = out.Size();
+		numSeen = 0;
+		if ( ++generation == 0 )
+		{
+			for (auto& seen : seenKeys)
+				seen.generation = 0;
+			generation = 1;
+		}
+		CountKey("RecordNumber", 12);
+		CountKey("Timestamp", 9);
+		out.Append("{\"RecordNumber\":", 16);
+		out.AppendUnsigned(number);
+		out.Append(",\"Timestamp\":\"", 14);
+		recordTime.Append(out, timestamp);
+		out.Append("Z\"", 2);
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+		out.Append("}\n", 2);
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		out.Truncate(recordStart);
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* valueKey, size_t valueKeyLen, ValueKind valueKind) {
+		key = valueKey;
+		keyLen = valueKeyLen;
+		kind = valueKind;
+		valueOpen = true;
+		AppendMember(out, key, keyLen);
+		if ( kind != ValueNumber )
+			out.Append('"');
+	}
+
+	void	EndValue(OutputBuffer& out) {
+		CloseValue(out);
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		CloseValue(out);
+		out.Append(",\"", 2);
+		AppendJsonEscaped(out, key, keyLen);
+		AppendOccurrence(out);
+		out.Append("_text\":\"", 8);
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		out.Append('"');
+	}
+
+	void	BeginList(OutputBuffer& out, const char* listKey, size_t listKeyLen) {
+		AppendMember(out, listKey, listKeyLen);
+		out.Append('[');
+		firstItem = true;
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		if ( !firstItem )
+			out.Append(',');
+		out.Append('"');
+		firstItem = false;
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+		out.Append('"');
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+		if ( itemOpen )
+			out.Append('"');
+		out.Append(']');
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		AppendJsonEscaped(out, str, len);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		fputs(text, stderr);	/*  not a part of the format */
+	}
+
+	bool	IsRecordIndependent() const {
+		return true;
+	}
+
+	/*  the numbers of repeated keys depend on what came before them in the record */
+	bool	KeysUnseen(const TemplateFixedPair* pairs, size_t numPairs) {
+		for (size_t idx = 0; idx < numPairs; idx++)
+		{
+			if ( pairs[idx].projected && seenKeys[FindKey(pairs[idx].key, pairs[idx].keyLen, HashKey(pairs[idx].key, pairs[idx].keyLen))].generation == generation )
+				return false;
+		}
+		return true;
+	}
+
+	void	NoteKeys(const TemplateFixedPair* pairs, size_t numPairs) {
+		for (size_t idx = 0; idx < numPairs; idx++)
+		{
+			if ( pairs[idx].projected )
+				CountKey(pairs[idx].key, pairs[idx].keyLen);
+		}
+	}
+
+private:
+	/*  Open addressing on the key text, BeginRecord() bumps the generation instead of clearing the slots */
+	struct SeenKey {
+		SeenKey() : key(NULL), len(0), hash(0), generation(0), count(0) {}
+		const char*	key;	/*  lives as long as the chunk's templates */
+		size_t		len;
+		uint32_t	hash;
+		uint32_t	generation;
+		unsigned	count;
+	};
+
+	/*  The first and the last eight bytes, keys are rarely longer than that */
+	static uint32_t	HashKey(const char* memberKey, size_t memberKeyLen) {
+		uint64_t	head	=	0;
+		uint64_t	tail	=	0;
+
+		memcpy(&head, memberKey, std::min<size_t>(memberKeyLen, sizeof(head)));
+		if ( memberKeyLen > sizeof(tail) )
+			memcpy(&tail, memberKey + memberKeyLen - sizeof(tail), sizeof(tail));
+		return (uint32_t)( ( ( head * 0x9E3779B97F4A7C15ULL ) ^ ( tail * 0xC2B2AE3D27D4EB4FULL ) ^ memberKeyLen ) >> 32 );
+	}
+
+	/*  The slot of the key, or the free one it would go to */
+	size_t	FindKey(const char* memberKey, size_t memberKeyLen, uint32_t hash) const {
+		size_t	mask	=	seenKeys.size() - 1;
+		size_t	idx;
+
+		for (idx = hash & mask; seenKeys[idx].generation == generation; idx = ( idx + 1 ) & mask)
+		{
+			const SeenKey&	seen	=	seenKeys[idx];
+
+			if ( seen.hash == hash && seen.len == memberKeyLen && ( seen.key == memberKey || !memcmp(seen.key, memberKey, memberKeyLen) ) )
+				break;
+		}
+		return idx;
+	}
+
+	unsigned	CountKey(const char* memberKey, size_t memberKeyLen) {
+		uint32_t	hash	=	HashKey(memberKey, memberKeyLen);
+		size_t		idx;
+
+		if ( ( numSeen + 1 ) * 2 > seenKeys.size() )
+			GrowSeenKeys();
+		idx = FindKey(memberKey, memberKeyLen, hash);
+		if ( seenKeys[idx].generation == generation )
+			return ++seenKeys[idx].count;
+		seenKeys[idx].key = memberKey;
+		seenKeys[idx].len = memberKeyLen;
+		seenKeys[idx].hash = hash;
+		seenKeys[idx].generation = generation;
+		seenKeys[idx].count = 1;
+		numSeen++;
+		return 1;
+	}
+
+	void	GrowSeenKeys() {
+		std::vector<SeenKey>	old(seenKeys.size() * 2);
+		size_t			mask	=	old.size() - 1;
+
+		old.swap(seenKeys);
+		for (auto& seen : old)
+		{
+			size_t	idx;
+
+			if ( seen.generation != generation )
+				continue;
+			for (idx = seen.hash & mask; seenKeys[idx].generation == generation; idx = ( idx + 1 ) & mask)
+				;
+			seenKeys[idx] = seen;
+		}
+	}
+
+	void	AppendOccurrence(OutputBuffer& out) {
+		if ( occurrence == 1 )
+			return;
+		out.Append('_');
+		out.AppendUnsigned(occurrence);
+	}
+
+	void	AppendMember(OutputBuffer& out, const char* memberKey, size_t memberKeyLen) {
+		occurrence = CountKey(memberKey, memberKeyLen);
+		out.Append(",\"", 2);
+		AppendJsonEscaped(out, memberKey, memberKeyLen);
+		AppendOccurrence(out);
+		out.Append("\":", 2);
+	}
+
+	void	CloseValue(OutputBuffer& out) {
+		if ( valueOpen && kind != ValueNumber )
+			out.Append('"');
+		valueOpen = false;
+	}
+
+	size_t			recordStart;
+	const char*		key;
+	size_t			keyLen;
+	unsigned		occurrence;	/*  of key in the record */
+	ValueKind		kind;
+	bool			valueOpen;
+	bool			firstItem;
+	std::vector<SeenKey>	seenKeys;	/*  of the record so far */
+	size_t			numSeen;
+	uint32_t		generation;
+};
+
+/*  Quotes are doubled; invalid UTF-8 becomes U+FFFD, as in the jsonl output */
+void	AppendCsvEscaped(OutputBuffer& out, const char* str, size_t len)
+{
+	size_t	start	=	0;
+
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		uint8_t	c	=	str[idx];
+
+		if ( c == '"' )
+		{
+			out.Append(str + start, idx + 1 - start);
+			start = idx;
+			continue;
+		}
+		if ( c < 0x80 )
+			continue;
+
+		size_t	seqLen	=	Utf8SequenceLength(reinterpret_cast<const uint8_t*>(str) + idx, len - idx);
+
+		if ( seqLen != 0 )
+		{
+			idx += seqLen - 1;
+			continue;
+		}
+		out.Append(str + start, idx - start);
+		out.Append("\xEF\xBF\xBD", 3);
+		start = idx + 1;
+	}
+	out.Append(str + start, len - start);
+}
+
+/*  One row per value: RecordNumber,Timestamp,"Key","Value"; a list gives a row per item */
+class CsvEmitter : public RecordEmitter {
+public:
+	CsvEmitter() : recordStart(0), prefixLen(0), key(NULL), keyLen(0) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		recordStart = out.Size();
+		out.AppendUnsigned(number);
+		out.Append(',');
+		recordTime.Append(out, timestamp);
+		out.Append("Z,", 2);
+		prefixLen = std::min(out.Size() - recordStart, sizeof(prefix));
+		memcpy(prefix, out.Data(recordStart), prefixLen);
+		out.Truncate(recordStart);
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		out.Truncate(recordStart);
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* valueKey, size_t valueKeyLen, ValueKind kind) {
+		BeginRow(out, valueKey, valueKeyLen);
+	}
+
+	void	EndValue(OutputBuffer& out) {
+		out.Append("\"\n", 2);
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		out.Append(" (", 2);
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		out.Append(')');
+	}
+
+	void	BeginList(OutputBuffer& out, const char* listKey, size_t listKeyLen) {
+		key = listKey;
+		keyLen = listKeyLen;
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		BeginRow(out, key, keyLen);
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+		out.Append("\"\n", 2);
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+		if ( itemOpen )
+			EndListItem(out);
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		AppendCsvEscaped(out, str, len);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		fputs(text, stderr);	/*  not a part of the format */
+	}
+
+	bool	IsRecordIndependent() const {
+		return false;	/*  every row starts with the record number */
+	}
+
+private:
+	void	BeginRow(OutputBuffer& out, const char* rowKey, size_t rowKeyLen) {
+		out.Append(prefix, prefixLen);
+		out.Append('"');
+		AppendCsvEscaped(out, rowKey, rowKeyLen);
+		out.Append("\",\"", 3);
+	}
+
+	size_t		recordStart;
+	char		prefix[64];
+	size_t		prefixLen;
+	const char*	key;
+	size_t		keyLen;
+};
+
+/*  --format=arrow: a compact row encoding that ArrowBatchWriter turns into columns when the chunk's turn to be printed
+ *  comes, so a record is still dropped by truncating the buffer. 'R' number timestamp, then 'V' keyLen key valueLen value
+ *  for every value; an annotation is a value of its own, "<key>_text" as in jsonl, and a list gives a value per item */
+#define ARROW_ROW_RECORD	'R'
+#define ARROW_ROW_VALUE		'V'
+
+class ArrowEmitter : public RecordEmitter {
+public:
+	ArrowEmitter() : recordStart(0), key(NULL), keyLen(0), lenPos(0), valueOpen(false) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		recordStart = out.Size();
+		out.Append(ARROW_ROW_RECORD);
+		out.Append(reinterpret_cast<const char*>(&number), sizeof(number));
+		out.Append(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		out.Truncate(recordStart);
+		valueOpen = false;
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* valueKey, size_t valueKeyLen, ValueKind kind) {
+		key = valueKey;
+		keyLen = valueKeyLen;
+		BeginItem(out, "");
+	}
+
+	void	EndValue(OutputBuffer& out) {
+		EndItem(out);
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		EndItem(out);
+		BeginItem(out, "_text");
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		EndItem(out);
+	}
+
+	void	BeginList(OutputBuffer& out, const char* listKey, size_t listKeyLen) {
+		key = listKey;
+		keyLen = listKeyLen;
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		BeginItem(out, "");
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+		EndItem(out);
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+		EndItem(out);
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		out.Append(str, len);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		fputs(text, stderr);	/*  not a part of the format */
+	}
+
+	bool	IsRecordIndependent() const {
+		return true;
+	}
+
+private:
+	void	BeginItem(OutputBuffer& out, const char* suffix) {
+		size_t		suffixLen	=	strlen(suffix);
+		uint32_t	len		=	(uint32_t)( keyLen + suffixLen );
+
+		out.Append(ARROW_ROW_VALUE);
+		out.Append(reinterpret_cast<const char*>(&len), sizeof(len));
+		out.Append(key, keyLen);
+		out.Append(suffix, suffixLen);
+		lenPos = out.Size();
+		out.Append("\0\0\0\0", 4);
+		valueOpen = true;
+	}
+
+	void	EndItem(OutputBuffer& out) {
+		uint32_t	len	=	(uint32_t)( out.Size() - lenPos - 4 );
+
+		if ( !valueOpen )
+			return;
+		out.Overwrite(lenPos, &len, sizeof(len));
+		valueOpen = false;
+	}
+
+	size_t		recordStart;
+	const char*	key;
+	size_t		keyLen;
+	size_t		lenPos;		/*  of the open value */
+	bool		valueOpen;
+};
+
+/*  Passes the records of EvtxVisitFile() on to the caller instead of formatting them, the values go straight
+ *  to Field(). A record is announced with its first value, so the ones dropped by the EventID filter are never seen */
+class VisitorEmitter : public RecordEmitter {
+public:
+	VisitorEmitter(EvtxVisitor* recordVisitor) : visitor(recordVisitor), number(0), timestamp(0), announced(true) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t recordNumber, uint64_t recordTimestamp, TimeFormatter& recordTime) {
+		number = recordNumber;
+		timestamp = recordTimestamp;
+		announced = false;
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+		Announce();
+		visitor->OnRecordEnd(true);
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		Announce();
+		visitor->OnRecordEnd(false);
+	}
+
+	void	Field(const char* key, size_t keyLen, uint16_t type, const uint8_t* data, size_t len) {
+		Announce();
+		visitor->OnField(key, keyLen, type, data, len);
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* key, size_t keyLen, ValueKind kind) {}
+	void	EndValue(OutputBuffer& out) {}
+	void	BeginAnnotation(OutputBuffer& out) {}
+	void	EndAnnotation(OutputBuffer& out) {}
+	void	BeginList(OutputBuffer& out, const char* key, size_t keyLen) {}
+	void	BeginListItem(OutputBuffer& out) {}
+	void	EndListItem(OutputBuffer& out) {}
+	void	EndList(OutputBuffer& out, bool itemOpen) {}
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		visitor->OnError(text);
+	}
+
+	bool	IsRecordIndependent() const {
+		return false;
+	}
+
+private:
+	void	Announce() {
+		if ( announced )
+			return;
+		visitor->OnRecord(number, timestamp);
+		announced = true;
+	}
+
+	EvtxVisitor*	visitor;
+	uint64_t	number;
+	uint64_t	timestamp;
+	bool		announced;
+};
+
+#define SUMMARY_TABLE_SLOTS_INITIAL	1024
+
+/*  --summarize: the number of records of every combination of values, a group. Open addressing on the hash of the
+ *  group, the groups themselves are kept one after the other in one buffer */
+class SummaryTable {
+public:
+	struct Group {
+		const char*	data;	/*  every value as its 32-bit length and bytes, UINT32_MAX if the record has none */
+		size_t		len;
+		uint64_t	count;
+	};
+
+	SummaryTable() : slots(SUMMARY_TABLE_SLOTS_INITIAL), numUsed(0) {}
+
+	void	Add(const char* group, size_t len, uint64_t count) {
+		Add(HashBytes(reinterpret_cast<const uint8_t*>(group), len), group, len, count);
+	}
+
+	void	Add(const SummaryTable& other) {
+		for (auto& slot : other.slots)
+		{
+			if ( slot.count != 0 )
+				Add(slot.hash, other.groups.data() + slot.offset, slot.len, slot.count);
+		}
+	}
+
+	/*  Largest count first, then by the values */
+	std::vector<Group>	Sorted() const {
+		std::vector<Group>	sorted;
+
+		for (auto& slot : slots)
+		{
+			if ( slot.count != 0 )
+				sorted.push_back(Group{ groups.data() + slot.offset, slot.len, slot.count });
+		}
+		std::sort(sorted.begin(), sorted.end(), [](const Group& a, const Group& b) {
+			int	order;
+
+			if ( a.count != b.count )
+				return a.count > b.count;
+			order = memcmp(a.data, b.data, std::min(a.len, b.len));
+			return order < 0 || ( order == 0 && a.len < b.len );
+		});
+		return sorted;
+	}
+
+private:
+	struct Slot {
+		Slot() : hash(0), offset(0), len(0), count(0) {}
+		uint64_t	hash;
+		size_t		offset;	/*  in groups */
+		size_t		len;
+		uint64_t	count;	/*  0 for a free slot */
+	};
+
+	void	Add(uint64_t hash, const char* group, size_t len, uint64_t count) {
+		size_t	mask;
+		size_t	idx;
+
+		if ( ( numUsed + 1 ) * 2 > slots.size() )
+			Grow();
+		mask = slots.size() - 1;
+		for (idx = hash & mask; slots[idx].count != 0; idx = ( idx + 1 ) & mask)
+		{
+			Slot&	slot	=	slots[idx];
+
+			if ( slot.hash == hash && slot.len == len && !memcmp(groups.data() + slot.offset, group, len) )
+			{
+				slot.count += count;
+				return;
+			}
+		}
+		slots[idx].hash = hash;
+		slots[idx].offset = groups.size();
+		slots[idx].len = len;
+		slots[idx].count = count;
+		groups.insert(groups.end(), group, group + len);
+		numUsed++;
+	}
+
+	void	Grow() {
+		std::vector<Slot>	old(slots.size() * 2);
+		size_t			mask	=	old.size() - 1;
+
+		old.swap(slots);
+		for (auto& slot : old)
+		{
+			size_t	idx;
+
+			if ( slot.count == 0 )
+				continue;
+			for (idx = slot.hash & mask; slots[idx].count != 0; idx = ( idx + 1 ) & mask)
+				;
+			slots[idx] = slot;
+		}
+	}
+
+	std::vector<Slot>	slots;
+	size_t			numUsed;
+	std::vector<char>	groups;
+};
+
+/*  Keys of --summarize that are not values but the hour or the day of the record timestamp */
+#define SUMMARY_KEY_HOUR	"Hour"
+#define SUMMARY_KEY_DAY		"Day"
+
+/*  --summarize: the values of the summary keys are taken from where the formatters put them in the output, and then
+ *  the record is dropped from it and counted in the table of its group. The first value of a key is the one that counts,
+ *  a list is its items joined with ", " and annotations are left out. Records that fail to parse are not counted */
+class SummaryEmitter : public RecordEmitter {
+public:
+	SummaryEmitter(const std::vector<std::string>& summaryKeys) : keys(summaryKeys), values(summaryKeys.size()), recordStart(0), current(-1), valueStart(0), annotationStart(0), firstItem(true) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		recordStart = out.Size();
+		recordTime.Append(out, timestamp);	/*  YYYY-MM-DDThh:mm:ss */
+		for (size_t idx = 0; idx < keys.size(); idx++)
+		{
+			values[idx].start = recordStart;
+			values[idx].end = recordStart;
+			if ( keys[idx] == SUMMARY_KEY_HOUR )
+				values[idx].end += 13;
+			else if ( keys[idx] == SUMMARY_KEY_DAY )
+				values[idx].end += 10;
+			values[idx].present = ( values[idx].end != recordStart );
+		}
+		current = -1;
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+		group.clear();
+		for (auto& value : values)
+		{
+			uint32_t	len	=	value.present ? (uint32_t)( value.end - value.start ) : UINT32_MAX;
+
+			group.insert(group.end(), reinterpret_cast<const char*>(&len), reinterpret_cast<const char*>(&len) + sizeof(len));
+			if ( value.present )
+				group.insert(group.end(), out.Data(value.start), out.Data(value.start) + len);
+		}
+		table.Add(group.data(), group.size(), 1);
+		out.Truncate(recordStart);
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		out.Truncate(recordStart);
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* key, size_t keyLen, ValueKind kind) {
+		current = FindKey(key, keyLen);
+		valueStart = out.Size();
+	}
+
+	void	EndValue(OutputBuffer& out) {
+		if ( current < 0 )
+			return;
+		values[current].start = valueStart;
+		values[current].end = out.Size();
+		values[current].present = true;
+		current = -1;
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		annotationStart = out.Size();
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		out.Truncate(annotationStart);
+	}
+
+	void	BeginList(OutputBuffer& out, const char* listKey, size_t listKeyLen) {
+		BeginValue(out, listKey, listKeyLen, ValueString);
+		firstItem = true;
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		if ( !firstItem )
+			out.Append(", ", 2);
+		firstItem = false;
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+		EndValue(out);
+	}
+
+	/*  one line per group in the report, so no control characters */
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		size_t	start	=	0;
+
+		for (size_t idx = 0; idx < len; idx++)
+		{
+			if ( (uint8_t)str[idx] >= 0x20 )
+				continue;
+			out.Append(str + start, idx - start);
+			out.Append(' ');
+			start = idx + 1;
+		}
+		out.Append(str + start, len - start);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		fputs(text, stderr);	/*  not a part of the report */
+	}
+
+	bool	IsRecordIndependent() const {
+		return false;
+	}
+
+	const SummaryTable&	Table() const {
+		return table;
+	}
+
+private:
+	struct Value {
+		size_t	start;		/*  in the output */
+		size_t	end;
+		bool	present;
+	};
+
+	int	FindKey(const char* key, size_t keyLen) const {
+		for (size_t idx = 0; idx < keys.size(); idx++)
+		{
+			if ( !values[idx].present && keys[idx].size() == keyLen && !memcmp(keys[idx].data(), key, keyLen) )
+				return (int)idx;
+		}
+		return -1;
+	}
+
+	const std::vector<std::string>&	keys;
+	std::vector<Value>		values;
+	std::vector<char>		group;
+	SummaryTable			table;
+	size_t				recordStart;
+	int				current;	/*  the key of the value being output, -1 if it is not one */
+	size_t				valueStart;
+	size_t				annotationStart;
+	bool				firstItem;
+};
+
+/*  --format=xml: what every byte turns into, the index of its escape or 0 for itself. The control characters
+ *  XML 1.0 can't have at all become U+FFFD; so do invalid UTF-8, which ANSI strings can have, and U+FFFE and U+FFFF */
+struct XmlEscapeTable {
+	XmlEscapeTable() {
+		memset(index, 0, sizeof(index));
+		for (unsigned c = 0; c < 0x20; c++)
+			index[c] = 5;
+		index[(uint8_t)'\t'] = index[(uint8_t)'\n'] = index[(uint8_t)'\r'] = 0;
+		index[(uint8_t)'&'] = 1;
+		index[(uint8_t)'<'] = 2;
+		index[(uint8_t)'>'] = 3;
+		index[(uint8_t)'"'] = 4;
+		for (unsigned c = 0x80; c < 0x100; c++)
+			index[c] = 6;
+	}
+
+	uint8_t		index[256];
+};
+
+const XmlEscapeTable	xmlEscapeTable;
+const char* const	xmlEscapes[]	=	{ "", "&amp;", "&lt;", "&gt;", "&quot;", "\xEF\xBF\xBD" };
+
+void	AppendXmlEscaped(OutputBuffer& out, const char* str, size_t len)
+{
+	size_t	start	=	0;
+
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		uint8_t	escape	=	xmlEscapeTable.index[(uint8_t)str[idx]];
+
+		if ( escape == 0 )
+			continue;
+		if ( escape == 6 )
+		{
+			const uint8_t*	p	=	reinterpret_cast<const uint8_t*>(str) + idx;
+			size_t		seqLen	=	Utf8SequenceLength(p, len - idx);
+
+			if ( seqLen != 0 && !( seqLen == 3 && p[0] == 0xEF && p[1] == 0xBF && p[2] >= 0xBE ) )
+			{
+				idx += seqLen - 1;
+				continue;
+			}
+			seqLen = std::max<size_t>(seqLen, 1);
+			out.Append(str + start, idx - start);
+			out.Append(xmlEscapes[5]);
+			start = idx + seqLen;
+			idx += seqLen - 1;
+			continue;
+		}
+		out.Append(str + start, idx - start);
+		out.Append(xmlEscapes[escape]);
+		start = idx + 1;
+	}
+	out.Append(str + start, len - start);
+}
+
+/*  One <Event> element per line. The XML itself is the text of the templates, see RenderTemplateXml(), only the
+ *  substituted values go through here, without their annotations */
+class XmlEmitter : public RecordEmitter {
+public:
+	XmlEmitter() : recordStart(0), annotationStart(0), firstItem(true) {}
+
+	void	BeginRecord(OutputBuffer& out, uint64_t number, uint64_t timestamp, TimeFormatter& recordTime) {
+		recordStart = out.Size();
+	}
+
+	void	EndRecord(OutputBuffer& out) {
+		out.Append('\n');
+	}
+
+	void	AbortRecord(OutputBuffer& out) {
+		out.Truncate(recordStart);
+	}
+
+	void	BeginValue(OutputBuffer& out, const char* valueKey, size_t valueKeyLen, ValueKind valueKind) {
+	}
+
+	void	EndValue(OutputBuffer& out) {
+	}
+
+	void	BeginAnnotation(OutputBuffer& out) {
+		annotationStart = out.Size();
+	}
+
+	void	EndAnnotation(OutputBuffer& out) {
+		out.Truncate(annotationStart);
+	}
+
+	void	BeginList(OutputBuffer& out, const char* listKey, size_t listKeyLen) {
+		firstItem = true;
+	}
+
+	void	BeginListItem(OutputBuffer& out) {
+		if ( !firstItem )
+			out.Append(", ", 2);
+		firstItem = false;
+	}
+
+	void	EndListItem(OutputBuffer& out) {
+	}
+
+	void	EndList(OutputBuffer& out, bool itemOpen) {
+	}
+
+	void	AppendEscaped(OutputBuffer& out, const char* str, size_t len) {
+		AppendXmlEscaped(out, str, len);
+	}
+
+	unsigned	NumberWidth(unsigned rawWidth) const {
+		return 0;
+	}
+
+	void	Message(OutputBuffer& out, const char* text) {
+		fputs(text, stderr);	/*  not a part of the format */
+	}
+
+	bool	IsRecordIndependent() const {
+		return true;
+	}
+
+private:
+	size_t		recordStart;
+	size_t		annotationStart;
+	bool		firstItem;
+};
+
+/*  --format=xml: turns the tokens of a template definition into its XML text once, with a slot for every substitution */
+class XmlTemplateBuilder {
+public:
+	XmlTemplateBuilder() : attribute(NULL), attributeState(NoAttribute), startTagOpen(false) {}
+
+	void	Begin() {
+		text.Clear();
+		slots.clear();
+		elements.clear();
+		attributeState = NoAttribute;
+		startTagOpen = false;
+	}
+
+	/*  Elements a broken definition left open are closed, the XML stays well-formed */
+	void	End(TemplateDescription* tmpl) {
+		while ( !elements.empty() )
+			CloseElement();
+		tmpl->xmlText.assign(text.Data(0), text.Data(0) + text.Size());
+		tmpl->xmlSlots.assign(slots.begin(), slots.end());
+	}
+
+	void	OpenElement(const char* name) {
+		CloseStartTag();
+		text.Append('<');
+		text.Append(name);
+		elements.push_back(name);
+		startTagOpen = true;
+	}
+
+	void	Attribute(const char* name) {
+		EndAttribute();
+		attribute = name;
+		attributeState = AttributePending;
+	}
+
+	/*  CloseStartElementToken, and before anything that goes into the element */
+	void	CloseStartTag() {
+		if ( !startTagOpen )
+			return;
+		EndAttribute();
+		text.Append('>');
+		startTagOpen = false;
+	}
+
+	/*  CloseEmptyElementToken or CloseElementToken */
+	void	CloseElement() {
+		if ( startTagOpen )
+		{
+			EndAttribute();
+			text.Append("/>", 2);
+			startTagOpen = false;
+		}
+		else if ( !elements.empty() )
+		{
+			text.Append("</", 2);
+			text.Append(elements.back());
+			text.Append('>');
+		}
+		if ( !elements.empty() )
+			elements.pop_back();
+	}
+
+	void	Text(const char* value) {
+		if ( attributeState == AttributeSlot )
+			return;
+		if ( attributeState == AttributePending )
+			OpenAttribute();
+		else if ( attributeState == NoAttribute )
+			CloseStartTag();
+		AppendXmlEscaped(text, value, strlen(value));
+	}
+
+	void	Substitution(uint16_t argIdx) {
+		TemplateXmlSlot	slot;
+
+		if ( attributeState == AttributeSlot )
+			return;
+		if ( attributeState == NoAttribute )
+			CloseStartTag();
+		slot.textPos = text.Size();
+		slot.nameLen = 0;
+		slot.argIdx = argIdx;
+		if ( attributeState == AttributePending )
+		{
+			slot.nameLen = strlen(attribute);
+			text.Append(attribute, slot.nameLen);
+			attributeState = AttributeSlot;
+		}
+		slots.push_back(slot);
+	}
+
+private:
+	typedef enum
+	{
+		NoAttribute,
+		AttributePending,	/*  nothing of it written yet */
+		AttributeOpen,		/*  name=" and the text so far */
+		AttributeSlot,		/*  taken by a substitution whole */
+	}
+	AttributeState;
+
+	void	OpenAttribute() {
+		text.Append(' ');
+		text.Append(attribute);
+		text.Append("=\"", 2);
+		attributeState = AttributeOpen;
+	}
+
+	void	EndAttribute() {
+		if ( attributeState == AttributePending )
+			OpenAttribute();
+		if ( attributeState == AttributeOpen )
+			text.Append('"');
+		attributeState = NoAttribute;
+	}
+
+	OutputBuffer			text;
+	std::vector<TemplateXmlSlot>	slots;
+	std::vector<const char*>	elements;	/*  names from the chunk's NameCache */
+	const char*			attribute;
+	AttributeState			attributeState;
+	bool				startTagOpen;
+};
+
+RecordEmitter*	CreateEmitter(EvtxFormat format)
+{
+	switch ( format )
+	{
+	case EvtxFormatJsonLines:
+		return new JsonEmitter;
+	case EvtxFormatCsv:
+		return new CsvEmitter;
+	case EvtxFormatArrow:
+		return new ArrowEmitter;
+	case EvtxFormatXml:
+		return new XmlEmitter;
+	default:
+		return new RawEmitter;
+	}
+}
+
+/*  Which records get printed, everything that can be checked without parsing a record is checked first */
+struct RecordFilter {
+	RecordFilter() : firstRecord(0), lastRecord(UINT64_MAX), since(0), until(UINT64_MAX) {}
+
+	void	AddEventID(uint16_t eventID) {
+		if ( eventIDs.empty() )
+			eventIDs.resize(0x10000 / 64);
+		if ( !MatchesEventID(eventID) )
+			eventIDList.push_back(eventID);
+		eventIDs[eventID >> 6] |= 1ULL << ( eventID & 63 );
+	}
+
+	bool	HasEventIDs() const {
+		return !eventIDs.empty();
+	}
+
+	bool	MatchesEventID(uint16_t eventID) const {
+		return eventIDs.empty() || ( ( eventIDs[eventID >> 6] >> ( eventID & 63 ) ) & 1 );
+	}
+
+	/*  Only the record header is needed */
+	bool	MatchesRecord(uint64_t number, uint64_t timestamp) const {
+		return number >= firstRecord && number <= lastRecord && timestamp >= since && timestamp <= until;
+	}
+
+	bool	IsActive() const {
+		return firstRecord != 0 || lastRecord != UINT64_MAX || since != 0 || until != UINT64_MAX || HasEventIDs();
+	}
+
+	/*  Whether a chunk described by the index can have a record to print */
+	bool	MatchesIndexEntry(const EvtxIndexEntry& entry) const {
+		if ( entry.flags & EVTX_INDEX_INCOMPLETE )
+			return true;
+		if ( entry.numRecords == 0 )
+			return false;
+		if ( entry.lastRecord < firstRecord || entry.firstRecord > lastRecord || entry.maxTime < since || entry.minTime > until )
+			return false;
+		if ( !HasEventIDs() )
+			return true;
+		for (auto eventID : eventIDList)
+			if ( IndexEntryMayHaveEventID(&entry, eventID) )
+				return true;
+		return false;
+	}
+
+	/*  Record range from the chunk header, a broken range never skips the chunk */
+	bool	MatchesChunk(uint64_t chunkFirstRecord, uint64_t chunkLastRecord) const {
+		if ( chunkFirstRecord > chunkLastRecord )
+			return true;
+		return chunkLastRecord >= firstRecord && chunkFirstRecord <= lastRecord;
+	}
+
+	uint64_t		firstRecord;	/*  inclusive */
+	uint64_t		lastRecord;
+	uint64_t		since;		/*  FILETIME, inclusive */
+	uint64_t		until;
+	std::vector<uint64_t>	eventIDs;	/*  bitmap of the wanted EventIDs, empty if any will do */
+	std::vector<uint16_t>	eventIDList;	/*  the same EventIDs for the index lookups */
+};
+
+/*  --fields: the keys to print, resolved once per template so that the other arguments are skipped undecoded */
+struct FieldProjection {
+	void	AddField(const char* key, size_t keyLen) {
+		keys.push_back(std::string(key, keyLen));
+	}
+
+	bool	IsActive() const {
+		return !keys.empty();
+	}
+
+	bool	Contains(const char* key) const {
+		for (auto& k : keys)
+			if ( k == key )
+				return true;
+		return false;
+	}
+
+	std::vector<std::string>	keys;
+};
+
+/*  Counted by every worker on its own and merged when it is done, the times are in nanoseconds */
+struct ParseStats {
+	ParseStats() {
+		memset(this, 0, sizeof(*this));
+	}
+
+	void	Add(const ParseStats& other) {
+		const uint64_t*	from	=	reinterpret_cast<const uint64_t*>(&other);
+		uint64_t*	to	=	reinterpret_cast<uint64_t*>(this);
+
+		for (size_t idx = 0; idx < sizeof(*this) / sizeof(uint64_t); idx++)
+			to[idx] += from[idx];
+	}
+
+	uint64_t	chunksParsed;
+	uint64_t	chunksSkipped;		/*  ruled out by the filter or the index */
+	uint64_t	chunksFailed;
+	uint64_t	chunksWithFailures;	/*  had a record that could not be parsed */
+	uint64_t	chunksCarved;		/*  --carve: found with a valid header checksum */
+	uint64_t	chunksDirty;		/*  --carve: of these, the ones whose records checksum did not match */
+	uint64_t	recordsSalvaged;	/*  --carve: corrupt records skipped in dirty chunks */
+	uint64_t	chunksVerified;		/*  --verify: both checksums match */
+	uint64_t	chunksUnverified;	/*  --verify: skipped, one of them does not */
+	uint64_t	recordsPrinted;
+	uint64_t	recordsFiltered;
+	uint64_t	recordsFailed;
+	uint64_t	templateHits;
+	uint64_t	templateMisses;		/*  definitions parsed */
+	uint64_t	templateCacheHits;	/*  definitions taken from the TemplateCache instead */
+	uint64_t	argumentsSkipped;	/*  no substitution in the template */
+	uint64_t	argumentCount[256];	/*  by the low byte of the value type */
+	uint64_t	argumentBytes[256];
+	uint64_t	bytesRead;
+	uint64_t	bytesWritten;
+	uint64_t	readTime;
+	uint64_t	parseTime;
+	uint64_t	templateTime;
+	uint64_t	outputTime;
+};
+
+#if defined(PARSE_EVTX_STATS)
+#define STATS_ADD(worker, counter, value)	( (worker)->stats.counter += (value) )
+#define STATS_TIMER(worker, name)		uint64_t name = (worker)->timing ? StatsNow() : 0
+#define STATS_ADD_TIME(worker, counter, name)	do { if ( (worker)->timing ) (worker)->stats.counter += StatsNow() - name; } while ( 0 )
+#else
+#define STATS_ADD(worker, counter, value)	do { } while ( 0 )
+#define STATS_TIMER(worker, name)		do { } while ( 0 )
+#define STATS_ADD_TIME(worker, counter, name)	do { } while ( 0 )
+#endif
+
+uint64_t	StatsNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*  --merge: where a record starts in the output of its chunk, and what it is ordered by */
+struct MergeKey {
+	size_t		offset;
+	uint64_t	number;
+	uint64_t	timestamp;
+};
+
+/*  Everything that used to be global parser state, one instance per worker thread */
+struct WorkerContext {
+	WorkerContext(EvtxFormat format, const RecordFilter* recordFilter) : ids(&arena), emitter(CreateEmitter(format)), filter(recordFilter), eventIDPending(false), recordFiltered(false), indexing(false), lastRecord(0), timing(false), templateCache(NULL), fields(NULL), visitor(NULL), summary(NULL), salvaging(false), verifying(false), merging(false), recordTime('-', 'T'), valueTime('.', '-'),
+		xml(format == EvtxFormatXml), xmlDefining(NULL), xmlTime('-', 'T') {
+		xmlTime.SetPrecision(EvtxTime100ns);
+	}
+
+	/*  EvtxVisitFile(): the values go to the visitor instead of the output */
+	void	SetVisitor(EvtxVisitor* recordVisitor) {
+		visitor = new VisitorEmitter(recordVisitor);
+		emitter.reset(visitor);
+	}
+
+	/*  --summarize: the records are counted instead of printed */
+	void	SetSummary(const std::vector<std::string>& summaryKeys) {
+		summary = new SummaryEmitter(summaryKeys);
+		emitter.reset(summary);
+	}
+
+	/*  Everything chunk-relative is dropped at the start of every chunk */
+	void	ResetChunk() {
+		ids.Reset();
+		names.Reset();
+		nameStack.Reset();
+		arena.Reset();
+	}
+
+	Arena				arena;
+	NameStack			nameStack;
+	Templates			ids;
+	NameCache			names;
+	OutputBuffer			out;
+	std::vector<char>		scratch;
+	std::unique_ptr<RecordEmitter>	emitter;
+	const RecordFilter*		filter;
+	bool				eventIDPending;	/*  the EventID filter is checked at the first template instance of the record */
+	bool				recordFiltered;	/*  parsing stopped because the record is not wanted */
+	bool				indexing;	/*  --build-index: only the record headers and EventIDs are collected */
+	EvtxIndexEntry			indexEntry;
+	uint64_t			lastRecord;	/*  highest record number printed from the current chunk, 0 if none */
+	ParseStats			stats;
+	bool				timing;		/*  --stats, the timers are only read when asked for */
+	TemplateCache*			templateCache;	/*  NULL parses every definition again in every chunk */
+	const FieldProjection*		fields;		/*  NULL prints every key */
+	VisitorEmitter*			visitor;	/*  the emitter if there is a visitor, NULL for the text output */
+	SummaryEmitter*			summary;	/*  the emitter with --summarize */
+	bool				salvaging;	/*  --carve: the chunk checksum failed, records are checked and skipped one by one */
+	bool				verifying;	/*  --verify: chunks with a bad checksum are skipped */
+	bool				merging;	/*  --merge: the records of the output are listed in recordKeys */
+	std::vector<MergeKey>		recordKeys;
+	TimeFormatter			recordTime;	/*  of the record headers */
+	TimeFormatter			valueTime;	/*  of the FILETIME values, in the historical 2020.01.31-23:59:59 form */
+	bool				xml;		/*  --format=xml: the templates are rendered as XML */
+	TemplateDescription*		xmlDefining;	/*  the template whose definition xmlBuilder gets the tokens of */
+	XmlTemplateBuilder		xmlBuilder;
+	std::vector<uint64_t>		xmlArgOffsets;	/*  where the values are, a stack for the nested BinXml values */
+	TimeFormatter			xmlTime;
+};
+
+/*  The XML builder if the tokens are those of a template definition */
+XmlTemplateBuilder*	XmlBuilding(ParseContext* ctx)
+{
+	return ( ctx->worker->xmlDefining != NULL && ctx->worker->xmlDefining == ctx->currentTemplatePtr ) ? &ctx->worker->xmlBuilder : NULL;
+}
+
+
+void	SetState(ParseContext* ctx, XmlParseState newState)
+{
+	if ( newState == ctx->state )
+		return;
+
+	if ( ctx->state == StateInAttribute )
+		ctx->worker->nameStack.PopName();
+
+	ctx->state = newState;
+}
+
+bool	ReadPrefixedUnicodeString(ParseContext* ctx, char* nameBuffer, uint64_t nameBufferSize, bool isNullTerminated)
+{
+	uint16_t	nameCharCnt;
+	uint64_t nameBufferUsed	=	0;
+	uint64_t idx		=	0;
+
+	if ( !ctx->ReadData(&nameCharCnt) )
+		return false;
+
+	/*  only as many characters as the buffer could ever take are decoded, the rest is skipped */
+	idx = ( nameCharCnt < nameBufferSize / 2 ) ? nameCharCnt : nameBufferSize / 2;
+	if ( !ctx->HaveEnoughData(idx*2) )
+		return false;
+	nameBufferUsed = UTF16ToUTF8Bulk(ctx->data + ctx->offset, idx, nameBuffer, nameBufferSize - 1);
+	ctx->SkipBytes(idx*2);
+	nameBuffer[nameBufferUsed] = 0;
+
+	ctx->SkipBytes((nameCharCnt - idx + ( isNullTerminated ? 1 : 0 ))*2);
+
+	return true;
+}
+
+bool	ReadName(ParseContext* ctx, const char** name)
+{
+	uint16_t	nameHash;
+	uint16_t	nameCharCnt;
+	uint32_t	chunkOffset;
+	uint32_t	d;
+	char		nameBuffer[256];
+	ParseContext	nameCtx;
+	ParseContext*	ctxPtr		=	ctx;
+	CachedName	cached;
+	bool		isInline;
+
+	if ( !ctx->ReadData(&chunkOffset) )
+		return false;
+	isInline = ( ctx->offset + ctx->offsetFromChunkStart == chunkOffset );
+
+	if ( ctx->worker->names.Find(chunkOffset, &cached) )
+	{
+		if ( isInline )
+			ctx->SkipBytes(sizeof(d) + sizeof(nameHash) + sizeof(nameCharCnt) + ( cached.charCount + 1 ) * 2);
+		*name = cached.name;
+		return true;
+	}
+
+	if ( !isInline )
+	{
+		// printf("!!!!!! %08X %08X\n", chunkOffset, (uint32_t)(ctx->offset + ctx->offsetFromChunkStart));
+		/*  only the reading part of the context is used */
+		nameCtx.data = ctx->chunkContext->data;
+		nameCtx.dataLen = ctx->chunkContext->dataLen;
+		nameCtx.offset = chunkOffset;
+		ctxPtr = &nameCtx;
+	}
+
+	if ( !ctxPtr->ReadData(&d) )
+		return false;
+	if ( !ctxPtr->ReadData(&nameHash) )
+		return false;
+	if ( !ctxPtr->HaveEnoughData(sizeof(nameCharCnt)) )
+		return false;
+	memcpy(&nameCharCnt, ctxPtr->data + ctxPtr->offset, sizeof(nameCharCnt));
+	if ( !ReadPrefixedUnicodeString(ctxPtr, nameBuffer, sizeof(nameBuffer), true) )
+		return false;
+
+	cached.name = ctx->worker->arena.Strdup(nameBuffer, strlen(nameBuffer));
+	cached.charCount = nameCharCnt;
+	ctx->worker->names.Insert(chunkOffset, cached);
+	*name = cached.name;
+
+	return true;
+}
+
+/*  FNV-1a, a piece at a time */
+void	HashAppend(uint64_t* hash, const void* data, size_t len)
+{
+	const uint8_t*	p	=	static_cast<const uint8_t*>(data);
+
+	for (size_t idx = 0; idx < len; idx++)
+		*hash = ( *hash ^ p[idx] ) * 0x100000001B3ULL;
+}
+
+/*  The TemplateCache key of a definition: the tokens ParseBinXml reads, with the names instead of their chunk offsets
+ *  and without the inline name definitions or the lengths that count them, so the same template hashes the same
+ *  wherever a chunk has it. False if it can't be cached: a nested template, a token of no definition or a short body */
+bool	HashTemplateDefinition(const ParseContext* templateCtx, uint64_t* hash)
+{
+	ParseContext	ctx	=	*templateCtx;
+	const char*	name;
+
+	*hash = 0xCBF29CE484222325ULL;
+	while ( ctx.offset < ctx.dataLen )
+	{
+		uint8_t		tag	=	ctx.data[ctx.offset++];
+		uint64_t	len	=	0;	/*  of what follows the tag and is hashed as it is */
+		uint16_t	charCount;
+
+		HashAppend(hash, &tag, sizeof(tag));
+		switch ( tag )
+		{
+		case 0x00:	/*  EOF, ParseBinXml stops there */
+			return true;
+		case 0x01:	/*  OpenStartElementToken: dependency ID, element length, name and the attribute list length */
+		case 0x41:
+			if ( !ctx.HaveEnoughData(sizeof(uint16_t) + sizeof(uint32_t)) )
+				return false;
+			HashAppend(hash, ctx.data + ctx.offset, sizeof(uint16_t));
+			ctx.SkipBytes(sizeof(uint16_t) + sizeof(uint32_t));
+			if ( !ReadName(&ctx, &name) )
+				return false;
+			HashAppend(hash, name, strlen(name) + 1);
+			if ( tag == 0x41 )
+				ctx.SkipBytes(sizeof(uint32_t));
+			break;
+		case 0x06:	/*  AttributeToken */
+		case 0x46:
+			if ( !ReadName(&ctx, &name) )
+				return false;
+			HashAppend(hash, name, strlen(name) + 1);
+			break;
+		case 0x05:	/*  ValueTextToken: the string type and the string */
+		case 0x45:
+			if ( !ctx.HaveEnoughData(sizeof(uint8_t) + sizeof(charCount)) )
+				return false;
+			memcpy(&charCount, ctx.data + ctx.offset + sizeof(uint8_t), sizeof(charCount));
+			len = sizeof(uint8_t) + sizeof(charCount) + charCount * 2;
+			break;
+		case 0x0D:	/*  Normal/OptionalSubstitutionToken: the ID and the type, after a 0 if there is one */
+		case 0x0E:
+			len = sizeof(uint16_t) + sizeof(uint8_t);
+			if ( ctx.HaveEnoughData(len) && ctx.data[ctx.offset + sizeof(uint16_t)] == 0x00 )
+				len++;
+			break;
+		case 0x0F:	/*  FragmentHeaderToken */
+			len = 3;
+			break;
+		case 0x02:
+		case 0x03:
+		case 0x04:
+		case 0x07:
+		case 0x47:
+		case 0x08:
+		case 0x48:
+		case 0x09:
+		case 0x49:
+		case 0x0A:
+		case 0x0B:
+			break;
+		default:
+			return false;
+		}
+		if ( !ctx.HaveEnoughData(len) )
+			return false;
+		HashAppend(hash, ctx.data + ctx.offset, len);
+		ctx.SkipBytes(len);
+	}
+	return true;
+}
+
+const char*	GetProperKeyName(ParseContext* ctx)
+{
+	const char*	key;
+	const char*	upperName;
+
+	key = ctx->worker->nameStack.GetName();
+
+	// printf("Key: %s Upper: %s\n", key, ctx->worker->nameStack.GetUpperName());
+
+	upperName = ctx->worker->nameStack.GetUpperName();
+
+	if ( ( upperName != NULL ) &&
+		( key != nullptr ) &&
+		!strcmp(key, "Data") &&
+		!strcmp(upperName, "EventData") &&
+		ctx->cachedValue[0] != 0 )
+	{
+		key = ctx->cachedValue;
+	}
+
+	return key;
+}
+
+bool	ParseValueText(ParseContext* ctx)
+{
+	uint8_t		stringType;
+	char		valueBuffer[256];
+	const char*	upperName;
+	const char*	key;
+
+	if ( !ctx->ReadData(&stringType) )
+		return false;
+	if ( !ReadPrefixedUnicodeString(ctx, valueBuffer, sizeof(valueBuffer), false) )
+		return false;
+	// printf("******* %s=%s", ctx->worker->nameStack.GetName(), valueBuffer);
+
+	key = GetProperKeyName(ctx);
+	upperName = ctx->worker->nameStack.GetUpperName();
+
+	if ( ( key != NULL ) &&
+		( ( upperName == NULL ) ||
+		strcmp(key, "Name") ||
+		strcmp(upperName, "Data") ) )
+	{
+		if ( ctx->currentTemplatePtr != nullptr ) {
+			ctx->currentTemplatePtr->RegisterFixedPair(key, valueBuffer);
+		}
+	}
+
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->Text(valueBuffer);
+	SetState(ctx, StateNormal);
+
+	ctx->cachedValue = ctx->worker->arena.Strdup(valueBuffer, strlen(valueBuffer));
+
+	return true;
+}
+
+bool	ParseAttributes(ParseContext* ctx)
+{
+	const char*	name;
+
+	if ( !ReadName(ctx, &name) )
+		return false;
+	// printf(" %s", name);
+
+	ctx->worker->nameStack.PushName(name);
+	SetState(ctx, StateInAttribute);
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->Attribute(name);
+
+	return true;
+}
+
+bool	ParseOpenStartElement(ParseContext* ctx, bool hasAttributes)
+{
+	uint8_t		b;
+	uint16_t	w;
+	uint32_t	elementLength;
+	uint32_t	attributeListLength	=	0;
+	const char*	name;
+
+	if ( !ctx->ReadData(&w) )
+		return false;
+	if ( !ctx->ReadData(&elementLength) )
+		return false;
+	if ( !ReadName(ctx, &name) )
+		return false;
+	if ( hasAttributes )
+	{
+		if ( !ctx->ReadData(&attributeListLength) )
+			return false;
+	}
+#ifdef PRINT_TAGS
+	printf("<%s [%08X] ", name, attributeListLength);
+	fflush(stdout);
+#endif
+
+	ctx->worker->nameStack.PushName(name);
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->OpenElement(name);
+
+	return true;
+}
+
+bool	ParseCloseStartElement(ParseContext* ctx)
+{
+	SetState(ctx, StateNormal);
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->CloseStartTag();
+#ifdef PRINT_TAGS
+	printf(">");
+	fflush(stdout);
+#endif
+	return true;
+}
+
+bool	ParseCloseElement(ParseContext* ctx)
+{
+	SetState(ctx, StateNormal);
+	ctx->worker->nameStack.PopName();
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->CloseElement();
+
+#ifdef PRINT_TAGS
+	printf("</>");
+	fflush(stdout);
+#endif
+	return true;
+}
+
+/*  EventID of a record from the fixed part of its template or from the substitution values, which are only peeked at */
+bool	FindEventID(const ParseContext* ctx, const TemplateDescription* tmpl, uint32_t numArguments, uint16_t* eventID)
+{
+	uint64_t	valueOffset	=	ctx->offset + (uint64_t)numArguments * 4;
+
+	for (auto &f : tmpl->fixed)
+	{
+		if ( f.keyClass == KeyEventID )
+		{
+			*eventID = f.eventID;
+			return true;
+		}
+	}
+
+	if ( !ctx->HaveEnoughData((uint64_t)numArguments * 4) )
+		return false;
+
+	for (uint64_t argumentIdx = 0; argumentIdx < numArguments; argumentIdx++)
+	{
+		const uint8_t*		entry	=	ctx->data + ctx->offset + argumentIdx * 4;
+		uint16_t		argLen	=	entry[0] | ( entry[1] << 8 );
+		uint16_t		argType	=	entry[2] | ( entry[3] << 8 );
+		const TemplateArgPair*	argPair	=	tmpl->GetArgPair(argumentIdx);
+
+		if ( argPair != NULL && argPair->keyClass == KeyEventID && argType == 0x06 )
+		{
+			if ( valueOffset + 2 > ctx->dataLen )
+				return false;
+			*eventID = ctx->data[valueOffset] | ( ctx->data[valueOffset + 1] << 8 );
+			return true;
+		}
+		valueOffset += argLen;
+	}
+
+	return false;
+}
+
+/*  Formatters for the substitution values, one per value type and key class. A template is compiled into
+ *  one of them per argument, the switch in SelectFormatter() only runs when a record brings another type */
+
+bool	FormatString(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&		out		=	ctx->worker->out;
+	RecordEmitter&		emit		=	*ctx->worker->emitter;
+	std::vector<char>&	scratch		=	ctx->worker->scratch;
+	uint64_t		stringSize	=	argLen*2+2;
+	uint64_t		stringNumUsed;
+
+	if ( !ctx->HaveEnoughData(argLen/2*2) )
+		return false;
+	if ( scratch.size() < stringSize )
+		scratch.resize(stringSize);
+	stringNumUsed = UTF16ToUTF8Bulk(ctx->data + ctx->offset, argLen/2, &scratch[0], stringSize - 1);
+	ctx->SkipBytes(argLen/2*2);
+	scratch[stringNumUsed] = 0;
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueString);
+	emit.AppendEscaped(out, &scratch[0]);	/*  up to an embedded NUL */
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatAnsiString(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	const char*	str	=	reinterpret_cast<const char*>(ctx->data + ctx->offset);
+	const char*	end;
+
+	if ( !ctx->HaveEnoughData(argLen) )
+		return false;
+	end = static_cast<const char*>(memchr(str, 0, argLen));	/*  up to an embedded NUL */
+	ctx->SkipBytes(argLen);
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueString);
+	emit.AppendEscaped(out, str, ( end != NULL ) ? end - str : argLen);
+	emit.EndValue(out);
+	return true;
+}
+
+/*  uint8_t, uint16_t and uint64_t, printed with the raw format's width of hex digits */
+template<class T, unsigned rawWidth>
+bool	FormatUnsigned(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	T		value;
+
+	if ( !ctx->ReadData(&value) )
+		return false;
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueNumber);
+	out.AppendUnsigned(value, emit.NumberWidth(rawWidth));
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatEventID(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	uint16_t		v_w;
+	const EventDescription*	description;
+
+	if ( !ctx->ReadData(&v_w) )
+		return false;
+
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueNumber);
+	out.AppendUnsigned(v_w, emit.NumberWidth(4));
+	if ( ( description = GetEventDescription(v_w) ) != NULL )
+	{
+		emit.BeginAnnotation(out);
+		emit.AppendEscaped(out, description->text, description->length);
+		emit.EndAnnotation(out);
+	}
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatLogonType(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	uint32_t	v_d;
+
+	if ( !ctx->ReadData(&v_d) )
+		return false;
+
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueNumber);
+	out.AppendUnsigned(v_d, emit.NumberWidth(8));
+	if ( ( v_d <= 11 ) && ( logonTypes[v_d] != NULL ))
+	{
+		emit.BeginAnnotation(out);
+		out.Append(logonTypes[v_d]);
+		emit.EndAnnotation(out);
+	}
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatAddress(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	uint32_t	v_d;
+	uint8_t*	ipPtr	=	reinterpret_cast<uint8_t*>(&v_d);
+
+	if ( !ctx->ReadData(&v_d) )
+		return false;
+
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueNumber);
+	out.AppendUnsigned(v_d, emit.NumberWidth(8));
+	emit.BeginAnnotation(out);
+	out.AppendUnsigned(ipPtr[0]);
+	out.Append('.');
+	out.AppendUnsigned(ipPtr[1]);
+	out.Append('.');
+	out.AppendUnsigned(ipPtr[2]);
+	out.Append('.');
+	out.AppendUnsigned(ipPtr[3]);
+	emit.EndAnnotation(out);
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatBinary(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&	out		=	ctx->worker->out;
+	RecordEmitter&	emit		=	*ctx->worker->emitter;
+	uint64_t	available	=	( ctx->offset < ctx->dataLen ) ? ctx->dataLen - ctx->offset : 0;
+	uint64_t	numBytes	=	std::min<uint64_t>(argLen, available);
+
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueText);
+	out.AppendHexBytes(ctx->data + ctx->offset, numBytes);
+	ctx->SkipBytes(numBytes);
+	if ( numBytes < argLen )
+		return false;
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatGUID(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	EvtxGUID	guid;
+
+	if ( !ctx->ReadData( &guid) )
+		return false;
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueText);
+	out.AppendGUID(guid);
+	emit.EndValue(out);
+	return true;
+}
+
+/*  HexInt32 and HexInt64 */
+template<class T>
+bool	FormatHex(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	T		value;
+
+	if ( !ctx->ReadData(&value) )
+		return false;
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueText);
+	out.AppendHex(value, sizeof(T) * 2);
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatFileTime(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	uint64_t	v_q;
+
+	if ( !ctx->ReadData( &v_q) )
+		return false;
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueText);
+	ctx->worker->valueTime.Append(out, v_q);
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatSID(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+	uint8_t		sid[2+6];
+	uint32_t	v_d;
+	uint64_t	v_q	=	0;
+
+	if ( argLen < sizeof(sid) )
+		return false;
+	if ( !ctx->ReadData(sid, sizeof(sid)) )
+		return false;
+	for (uint64_t idx = 0; idx < 6; idx++)
+	{
+		v_q <<= 8;
+		v_q |= sid[2+idx];
+	}
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueText);
+	out.Append("S-", 2);
+	out.AppendUnsigned(sid[0]);
+	out.Append('-');
+	out.AppendUnsigned(v_q);
+	for (uint64_t idx = sizeof(sid); idx + 4 <= argLen; idx += 4)
+	{
+		if ( !ctx->ReadData( &v_d) )
+			return false;
+		out.Append('-');
+		out.AppendUnsigned(v_d);
+	}
+	emit.EndValue(out);
+	return true;
+}
+
+bool	FormatBinXml(ParseContext* ctx, const TemplateArgPair*, uint16_t argLen)
+{
+	ParseContext	temporaryCtx(*ctx);
+
+	temporaryCtx.UpdateLen(temporaryCtx.offset + argLen);
+	if ( !ParseBinXml(&temporaryCtx, 0) )
+		;//return false;
+	// printf("=====<<<<< %08X\n", argLen);
+	ctx->SkipBytes(argLen);
+	return true;
+}
+
+/*  Null terminated unicode strings */
+bool	FormatStringArray(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&		out		=	ctx->worker->out;
+	RecordEmitter&		emit		=	*ctx->worker->emitter;
+	const uint8_t*		units		=	ctx->data + ctx->offset;
+	uint64_t		numUnits	=	argLen / 2;
+	std::vector<char>&	scratch		=	ctx->worker->scratch;
+	bool			inString	=	false;
+
+	if ( !ctx->HaveEnoughData(argLen) )
+		numUnits = ( ctx->offset < ctx->dataLen ) ? ( ctx->dataLen - ctx->offset ) / 2 : 0;
+
+	emit.BeginList(out, argPair->key, argPair->keyLen);
+
+	for (uint64_t idx = 0; idx < numUnits; )
+	{
+		uint64_t	end	=	idx;
+
+		while ( end < numUnits && ( units[end*2] | units[end*2+1] ) != 0 )
+			end++;
+
+		if ( end > idx )
+		{
+			uint64_t	used;
+
+			if ( scratch.size() < ( end - idx ) * 3 )
+				scratch.resize(( end - idx ) * 3);
+			used = UTF16ToUTF8Bulk(units + idx*2, end - idx, &scratch[0], scratch.size());
+			for (uint64_t pos = 0; pos < used; pos++)
+				if ( scratch[pos] == '\r' || scratch[pos] == '\n' )
+					scratch[pos] = ' ';
+			emit.BeginListItem(out);
+			emit.AppendEscaped(out, &scratch[0], used);
+			inString = true;
+		}
+
+		if ( end < numUnits && inString )
+		{
+			emit.EndListItem(out);
+			inString = false;
+		}
+		idx = end + 1;
+	}
+
+	emit.EndList(out, inString);
+
+	ctx->SkipBytes(argLen);
+	return true;
+}
+
+/*  void, the optional substitution is left out */
+bool	FormatNothing(ParseContext* ctx, const TemplateArgPair*, uint16_t argLen)
+{
+	ctx->SkipBytes(argLen);
+	return true;
+}
+
+bool	FormatUnknown(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+
+	emit.BeginValue(out, argPair->key, argPair->keyLen, ValueString);
+	out.Append("...//", 5);
+	out.AppendHex(argPair->type, 4);
+	out.Append('[');
+	out.AppendHex(argLen, 4);
+	out.Append(']');
+	emit.EndValue(out);
+	ctx->SkipBytes(argLen);
+	return true;
+}
+
+/*  EvtxVisitFile(): the raw value goes to the visitor */
+bool	FormatVisit(ParseContext* ctx, const TemplateArgPair* argPair, uint16_t argLen)
+{
+	if ( !ctx->HaveEnoughData(argLen) )
+		return false;
+	ctx->worker->visitor->Field(argPair->key, argPair->keyLen, argPair->type, ctx->data + ctx->offset, argLen);
+	ctx->SkipBytes(argLen);
+	return true;
+}
+
+ArgumentFormatter	SelectFormatter(uint16_t argType, KeyClass keyClass, bool visiting)
+{
+	if ( visiting )
+	{
+		if ( argType == 0x00 )
+			return FormatNothing;
+		return ( argType == 0x21 ) ? FormatBinXml : FormatVisit;
+	}
+
+	switch(argType)
+	{
+	case 0x00:	return FormatNothing;
+	case 0x01:	return FormatString;
+	case 0x02:	return FormatAnsiString;	/*  AnsiStringType  */
+	case 0x04:	return FormatUnsigned<uint8_t, 2>;
+	case 0x06:	return ( keyClass == KeyEventID ) ? FormatEventID : FormatUnsigned<uint16_t, 4>;
+	case 0x08:
+		if ( keyClass == KeyLogonType )
+			return FormatLogonType;
+		if ( keyClass == KeyAddress )
+			return FormatAddress;
+		return FormatUnsigned<uint32_t, 8>;
+	case 0x0A:	return FormatUnsigned<uint64_t, 16>;
+	case 0x0E:	return FormatBinary;
+	case 0x0F:	return FormatGUID;
+	case 0x11:	return FormatFileTime;
+	case 0x13:	return FormatSID;
+	case 0x14:	return FormatHex<uint32_t>;	/*  HexInt32 */
+	case 0x15:	return FormatHex<uint64_t>;	/*  HexInt64 */
+	case 0x21:	return FormatBinXml;
+	case 0x81:	return FormatStringArray;
+	default:	return FormatUnknown;
+	}
+}
+
+/*  --format=xml: the values the way wevtutil writes them, everything else is the same as in the other formats */
+
+bool	FormatXmlGUID(ParseContext* ctx, const TemplateArgPair*, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	EvtxGUID	guid;
+
+	if ( !ctx->ReadData(&guid) )
+		return false;
+	out.Append('{');
+	out.AppendHex(guid.d1, 8);
+	out.Append('-');
+	out.AppendHex(guid.w1, 4);
+	out.Append('-');
+	out.AppendHex(guid.w2, 4);
+	out.Append('-');
+	out.AppendHexBytes(guid.b1, 2);
+	out.Append('-');
+	out.AppendHexBytes(guid.b1 + 2, sizeof(guid.b1) - 2);
+	out.Append('}');
+	return true;
+}
+
+/*  0x and lowercase digits without padding */
+template<class T>
+bool	FormatXmlHex(ParseContext* ctx, const TemplateArgPair*, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	T		value;
+	char		digits[2 + sizeof(T) * 2];
+	size_t		pos	=	sizeof(digits);
+
+	if ( !ctx->ReadData(&value) )
+		return false;
+	do {
+		digits[--pos] = "0123456789abcdef"[value & 0x0F];
+		value >>= 4;
+	} while ( value != 0 );
+	digits[--pos] = 'x';
+	digits[--pos] = '0';
+	out.Append(digits + pos, sizeof(digits) - pos);
+	return true;
+}
+
+/*  2017-09-16T01:47:17.433558200Z */
+bool	FormatXmlFileTime(ParseContext* ctx, const TemplateArgPair*, uint16_t)
+{
+	OutputBuffer&	out	=	ctx->worker->out;
+	uint64_t	v_q;
+
+	if ( !ctx->ReadData(&v_q) )
+		return false;
+	ctx->worker->xmlTime.Append(out, v_q);
+	out.Append("00Z", 3);
+	return true;
+}
+
+ArgumentFormatter	SelectXmlFormatter(uint16_t argType)
+{
+	switch(argType)
+	{
+	case 0x0F:	return FormatXmlGUID;
+	case 0x11:	return FormatXmlFileTime;
+	case 0x14:	return FormatXmlHex<uint32_t>;
+	case 0x15:	return FormatXmlHex<uint64_t>;
+	default:	return SelectFormatter(argType, KeyPlain, false);
+	}
+}
+
+/*  --format=xml: the template's XML with the values of the record in its slots. A value can be in several slots or in none */
+bool	RenderTemplateXml(ParseContext* ctx, const TemplateDescription* tmpl, const uint8_t* argumentMap, uint32_t numArguments)
+{
+	OutputBuffer&		out		=	ctx->worker->out;
+	std::vector<uint64_t>&	offsets		=	ctx->worker->xmlArgOffsets;
+	size_t			base		=	offsets.size();
+	size_t			start		=	out.Size();
+	uint64_t		valuesEnd	=	ctx->offset;
+	const char*		text		=	tmpl->xmlText.data();
+	size_t			textPos		=	0;
+	bool			result		=	true;
+
+	for (uint32_t argumentIdx = 0; argumentIdx < numArguments; argumentIdx++)
+	{
+		offsets.push_back(valuesEnd);
+		valuesEnd += argumentMap[argumentIdx * 4] | ( argumentMap[argumentIdx * 4 + 1] << 8 );
+	}
+
+	for (auto& slot : tmpl->xmlSlots)
+	{
+		const TemplateOp*	op	=	( slot.argIdx < tmpl->program.size() ) ? &tmpl->program[slot.argIdx] : NULL;
+		const uint8_t*		entry	=	argumentMap + slot.argIdx * 4;
+		uint16_t		argLen	=	0;
+		uint16_t		argType	=	0x00;
+
+		if ( slot.argIdx < numArguments && op != NULL && op->argPair != NULL )
+		{
+			argLen = entry[0] | ( entry[1] << 8 );
+			argType = entry[2] | ( entry[3] << 8 );
+		}
+		out.Append(text + textPos, slot.textPos - textPos);
+		textPos = slot.textPos + slot.nameLen;
+		if ( argType == 0x00 )
+			continue;
+
+		ArgumentFormatter	format	=	( argType == op->type ) ? op->format : SelectXmlFormatter(argType);
+
+		STATS_ADD(ctx->worker, argumentCount[argType & 0xFF], 1);
+		STATS_ADD(ctx->worker, argumentBytes[argType & 0xFF], argLen);
+		if ( slot.nameLen != 0 )
+		{
+			out.Append(' ');
+			out.Append(text + slot.textPos, slot.nameLen);
+			out.Append("=\"", 2);
+		}
+		ctx->offset = offsets[base + slot.argIdx];
+		if ( !format(ctx, op->argPair, argLen) )
+		{
+			result = false;
+			break;
+		}
+		if ( slot.nameLen != 0 )
+			out.Append('"');
+	}
+	if ( result )
+		out.Append(text + textPos, tmpl->xmlText.size() - textPos);
+	else
+		out.Truncate(start);	/*  a nested value that breaks leaves nothing half open */
+
+	offsets.resize(base);
+	ctx->offset = valuesEnd;
+	return result;
+}
+
+/*  One op per argument of the template, the record's argument map only has to be checked against the type.
+ *  Keys left out by --fields are skipped, except for BinXml values whose own templates are projected in turn;
+ *  the XML has all of them */
+void	CompileTemplate(TemplateDescription* tmpl, const FieldProjection* fields, bool visiting, bool xml)
+{
+	bool	projecting	=	( fields != NULL && fields->IsActive() && !xml );
+
+	for (auto& f : tmpl->fixed)
+		f.projected = !projecting || fields->Contains(f.key);
+
+	tmpl->program.resize(tmpl->args.size());
+	for (size_t idx = 0; idx < tmpl->args.size(); idx++)
+	{
+		const TemplateArgPair&	argPair	=	tmpl->args[idx];
+		TemplateOp&		op	=	tmpl->program[idx];
+
+		op.argPair = ( argPair.key != nullptr ) ? &argPair : NULL;
+		if ( op.argPair != NULL && projecting && argPair.type != 0x21 && !fields->Contains(argPair.key) )
+			op.argPair = NULL;
+		op.type = argPair.type;
+		if ( op.argPair == NULL )
+			op.format = NULL;
+		else
+			op.format = xml ? SelectXmlFormatter(argPair.type) : SelectFormatter(argPair.type, argPair.keyClass, visiting);
+	}
+	tmpl->compiled = true;
+	tmpl->fixedRendered = false;
+}
+
+bool	ParseTemplateInstance(ParseContext* ctx)
+{
+	uint8_t		b;
+	uint32_t	numArguments;
+	uint32_t	shortID;
+	uint32_t	tempResLen;
+	uint32_t	totalArgLen		=	0;
+
+	if ( !ctx->ReadData(&b) )
+		return false;
+	if ( b != 0x01 )
+		return false;
+	if ( !ctx->ReadData(&shortID) )
+		return false;
+	if ( !ctx->ReadData(&tempResLen) )
+		return false;
+	if ( !ctx->ReadData(&numArguments) )
+		return false;
+
+#if defined(PRINT_TAGS)
+	printf("OK, template %08X, num arguments %X\n", shortID, numArguments);
+#endif
+
+	if ( ctx->worker->ids.IsKnownID(shortID, &ctx->currentTemplatePtr) )
+	{
+		STATS_ADD(ctx->worker, templateHits, 1);
+	}
+	else
+	//if ( numArguments == 0x00000000 )
+	{
+		uint8_t		longID[16];
+		uint32_t	templateBodyLen;
+		ParseContext	templateCtx;
+		ParseContext	definitionCtx;
+		ParseContext*	defPtr		=	ctx;
+		bool		isInline	=	( ctx->offset + ctx->offsetFromChunkStart - sizeof(numArguments) == tempResLen );
+
+		if ( !isInline )
+		{
+			/*  defined by an earlier record that was skipped, only the reading part of the context is used */
+			definitionCtx.worker = ctx->worker;
+			definitionCtx.data = ctx->chunkContext->data;
+			definitionCtx.dataLen = ctx->chunkContext->dataLen;
+			definitionCtx.offset = (uint64_t)tempResLen + sizeof(numArguments);	/*  past the next definition offset */
+			definitionCtx.offsetFromChunkStart = 0;
+			definitionCtx.chunkContext = &definitionCtx;
+			defPtr = &definitionCtx;
+		}
+
+		/* template definition follows */
+		if ( !defPtr->ReadData(&longID[0], sizeof(longID)) )
+			return false;
+		if ( !defPtr->ReadData(&templateBodyLen) )
+			return false;
+		// printf("Template body, len %08X\n", templateBodyLen);
+
+		templateCtx.InheritWithOffset(defPtr, templateBodyLen);  // this will also fix the body len if it's out of bounds
+
+		if ( !ctx->worker->ids.RegisterID(shortID, &templateCtx.currentTemplatePtr) ) {
+			return false; // BAD
+		}
+
+		TemplateCache*			cache		=	ctx->worker->templateCache;
+		uint64_t			bodyHash	=	0;
+		const TemplateDescription*	cached		=	NULL;
+
+		if ( cache != NULL && !HashTemplateDefinition(&templateCtx, &bodyHash) )
+			cache = NULL;
+		if ( cache != NULL )
+			cached = cache->Find(longID, bodyHash);
+
+		if ( cached != NULL )
+		{
+			STATS_ADD(ctx->worker, templateCacheHits, 1);
+			templateCtx.currentTemplatePtr->CopyFrom(*cached, false);
+		}
+		else
+		{
+			STATS_ADD(ctx->worker, templateMisses, 1);
+			STATS_TIMER(ctx->worker, definitionStart);
+
+			TemplateDescription*	defining	=	ctx->worker->xmlDefining;
+			bool			defined;
+
+			if ( ctx->worker->xml )
+			{
+				ctx->worker->xmlDefining = templateCtx.currentTemplatePtr;
+				ctx->worker->xmlBuilder.Begin();
+			}
+			defined = ParseBinXml(&templateCtx, 0);
+			if ( ctx->worker->xml )
+			{
+				ctx->worker->xmlBuilder.End(templateCtx.currentTemplatePtr);
+				ctx->worker->xmlDefining = defining;
+			}
+			if ( !defined )
+				return false;
+
+			STATS_ADD_TIME(ctx->worker, templateTime, definitionStart);
+			if ( cache != NULL )
+				cache->Insert(longID, bodyHash, *templateCtx.currentTemplatePtr);
+		}
+
+		if ( isInline )
+		{
+			ctx->SkipBytes(templateBodyLen);
+
+			if ( !ctx->ReadData(&numArguments) )
+				return false;
+		}
+
+		ctx->currentTemplatePtr = templateCtx.currentTemplatePtr;
+	}
+
+	// printf("Number of arguments: %08X\n", numArguments);
+
+	OutputBuffer&	out	=	ctx->worker->out;
+	RecordEmitter&	emit	=	*ctx->worker->emitter;
+
+	TemplateDescription*	tmpl	=	ctx->currentTemplatePtr;
+
+	if ( ctx->worker->eventIDPending )
+	{
+		uint16_t	eventID;
+
+		ctx->worker->eventIDPending = false;
+		if ( !FindEventID(ctx, tmpl, numArguments, &eventID) )
+		{
+			ctx->worker->recordFiltered = true;
+			return false;
+		}
+		if ( ctx->worker->indexing )
+		{
+			IndexEntryAddEventID(&ctx->worker->indexEntry, eventID);
+			ctx->worker->recordFiltered = true;	/*  nothing else is needed */
+			return false;
+		}
+		if ( !ctx->worker->filter->MatchesEventID(eventID) )
+		{
+			ctx->worker->recordFiltered = true;
+			return false;
+		}
+	}
+
+	if ( !tmpl->compiled )
+		CompileTemplate(tmpl, ctx->worker->fields, ctx->worker->visitor != NULL, ctx->worker->xml);
+
+	if ( ctx->worker->xml )
+	{
+		const uint8_t*	argumentMap	=	ctx->data + ctx->offset;
+
+		if ( !ctx->HaveEnoughData((uint64_t)numArguments * 4) )
+			return false;
+		ctx->SkipBytes((uint64_t)numArguments * 4);
+		return RenderTemplateXml(ctx, tmpl, argumentMap, numArguments);
+	}
+
+	bool	fixedReusable	=	emit.KeysUnseen(tmpl->fixed.data(), tmpl->fixed.size());
+
+	if ( tmpl->fixedRendered && fixedReusable )
+	{
+		if ( !tmpl->renderedFixed.empty() )
+			out.Append(&tmpl->renderedFixed[0], tmpl->renderedFixed.size());
+		emit.NoteKeys(tmpl->fixed.data(), tmpl->fixed.size());
+	}
+	else
+	{
+		size_t	fixedStart	=	out.Size();
+
+		for (auto &f : tmpl->fixed){
+			if ( !f.projected )
+				continue;
+			if ( ctx->worker->visitor != NULL )
+			{
+				ctx->worker->visitor->Field(f.key, f.keyLen, EVTX_TYPE_TEXT, reinterpret_cast<const uint8_t*>(f.value), f.valueLen);
+				continue;
+			}
+			if ( f.eventDescription != NULL )
+			{
+				emit.BeginValue(out, f.key, f.keyLen, ValueNumber);
+				out.AppendUnsigned(f.eventID);
+				emit.BeginAnnotation(out);
+				emit.AppendEscaped(out, f.eventDescription->text, f.eventDescription->length);
+				emit.EndAnnotation(out);
+				emit.EndValue(out);
+			}
+			else
+			{
+				emit.BeginValue(out, f.key, f.keyLen, ValueString);
+				emit.AppendEscaped(out, f.value);
+				emit.EndValue(out);
+			}
+		}
+
+		if ( emit.IsRecordIndependent() && fixedReusable )
+		{
+			tmpl->renderedFixed.assign(out.Data(0) + fixedStart, out.Data(0) + out.Size());
+			tmpl->fixedRendered = true;
+		}
+	}
+
+	// printf("\n");
+
+	/*  (length, type) pairs, read in place */
+	const uint8_t*	argumentMap	=	ctx->data + ctx->offset;
+
+	if ( !ctx->HaveEnoughData((uint64_t)numArguments * 4) )
+	{
+		emit.Message(out, "Failed to read the arguments\n");
+		return false;
+	}
+	ctx->SkipBytes((uint64_t)numArguments * 4);
+
+	for (uint64_t argumentIdx = 0; argumentIdx < numArguments; argumentIdx++)
+	{
+		const uint8_t*		entry		=	argumentMap + argumentIdx * 4;
+		uint16_t		argLen		=	entry[0] | ( entry[1] << 8 );
+		uint16_t		argType		=	entry[2] | ( entry[3] << 8 );
+		const TemplateOp*	op		=	( argumentIdx < tmpl->program.size() ) ? &tmpl->program[argumentIdx] : NULL;
+
+		//printf("\n %08X : [%02X %02X %02X] Arg %" PRIX64" type %08X len %08X\n",
+		//		(uint32_t)ctx->offset, ctx->data[ctx->offset], ctx->data[ctx->offset+1], ctx->data[ctx->offset+2],
+		//		argumentIdx, argType, argLen);
+		if ( op == NULL || op->argPair == NULL )
+		{
+			STATS_ADD(ctx->worker, argumentsSkipped, 1);
+			// printf("Argument not found\n");
+			ctx->SkipBytes(argLen);
+		}
+		else
+		{
+			ArgumentFormatter	format	=	( argType == op->type ) ? op->format : SelectFormatter(argType, op->argPair->keyClass, ctx->worker->visitor != NULL);
+
+			STATS_ADD(ctx->worker, argumentCount[argType & 0xFF], 1);
+			STATS_ADD(ctx->worker, argumentBytes[argType & 0xFF], argLen);
+
+			if ( !format(ctx, op->argPair, argLen) )
+				return false;
+		}
+
+		totalArgLen += argLen;
+	}
+
+	return true;
+}
+
+
+bool	ParseOptionalSubstitution(ParseContext* ctx)
+{
+	uint16_t	substitutionID;
+	uint8_t		valueType;
+
+	if ( !ctx->ReadData(&substitutionID) )
+		return false;
+	if ( !ctx->ReadData(&valueType) )
+		return false;
+	if ( valueType == 0x00 )
+	{
+		if ( !ctx->ReadData(&valueType) )
+			return false;
+	}
+
+	// printf("******* %s=<<param %X/type %X>> ", ctx->worker->nameStack.GetName(), substitutionID, valueType);
+	if ( ctx->currentTemplatePtr != nullptr ) {
+		ctx->currentTemplatePtr->RegisterArgPair(GetProperKeyName(ctx), valueType, substitutionID);
+	}
+	if ( XmlBuilding(ctx) != NULL )
+		XmlBuilding(ctx)->Substitution(substitutionID);
+	SetState(ctx, StateNormal);
+
+	return true;
+}
+
+bool	ParseBinXmlPre(WorkerContext* worker, const uint8_t* data, uint64_t dataLen, uint64_t chunkOffsetInFile, uint64_t inChunkOffset)
+{
+	ParseContext	ctx;
+
+	ctx.worker = worker;
+	ctx.data = data;
+	ctx.dataLen = dataLen;
+	ctx.offset = inChunkOffset;
+	ctx.currentTemplatePtr = nullptr;
+	ctx.chunkContext = &ctx;
+	ctx.offsetFromChunkStart = 0;
+	ctx.cachedValue = "";
+
+	return ParseBinXml(&ctx, chunkOffsetInFile);
+}
+
+bool	ParseBinXml(ParseContext* ctx, uint64_t chunkOffsetInFile) {
+	bool	result	=	true;
+
+	ctx->state = StateNormal;
+
+#if defined(PRINT_TAGS)
+	printf("ParseBinXml(%08X, %08X)\n", (uint32_t)ctx->offset, (uint32_t)ctx->dataLen);
+#endif
+
+	while ( result && ( ctx->offset < ctx->dataLen ) )
+	{
+		uint8_t	tag	=	ctx->data[ctx->offset++];
+
+#if defined(PRINT_TAGS)
+		uint64_t realOffset = chunkOffsetInFile + ctx->offset + ( ctx->data - ctx->chunkContext->data );
+
+		printf("%08zX: %02X ", realOffset, tag);
+		printf("%08zX: %02X %02X %02X", realOffset, tag, ctx->data[ctx->offset], ctx->data[ctx->offset+1]);
+		fflush(stdout);
+#endif
+
+		switch(tag)
+		{
+		case 0x00:	/*  EOF */
+			ctx->offset = ctx->dataLen;
+			break;
+		case 0x01:	/*  OpenStartElementToken */
+			result = ParseOpenStartElement(ctx, false);
+			break;
+		case 0x41:
+			result = ParseOpenStartElement(ctx, true);
+			break;
+		case 0x02:	/* CloseStartElementToken */
+			result = ParseCloseStartElement(ctx);
+			break;
+		case 0x03:	/*  CloseEmptyElementToken */
+		case 0x04:	/*  CloseElementToken */
+			result = ParseCloseElement(ctx);
+			break;
+		case 0x05:	/*  ValueTextToken */
+		case 0x45:
+			result = ParseValueText(ctx);
+			break;
+		case 0x06:	/*  AttributeToken */
+		case 0x46:
+			result = ParseAttributes(ctx);
+			break;
+		case 0x07:	/* CDATASectionToken */
+		case 0x47:
+			break;
+		case 0x08:	/* CharRefToken */
+		case 0x48:
+			break;
+		case 0x09:	/*  EntityRefToken */
+		case 0x49:
+			break;
+		case 0x0A:	/*  PITargetToken */
+			break;
+		case 0x0B:	/*  PIDataToken */
+			break;
+		case 0x0C: /*  TemplateInstanceToken */
+			result = ParseTemplateInstance(ctx);
+			break;
+		case 0x0D:	/*  NormalSubstitutionToken */
+		case 0x0E:	/*  OptionalSubstitutionToken */
+			result = ParseOptionalSubstitution(ctx);
+			break;
+		case 0x0F: /*  FragmentHeaderToken */
+			ctx->SkipBytes( 3);
+			break;
+
+		default:
+			result = false;
+			break;
+		}
+
+#if defined(PRINT_TAGS)
+		printf("\n");
+#endif
+	}
+
+	return result;
+}
+
+typedef enum
+{
+	ChunkParsed		=	1,
+	ChunkEndOfFile		=	2,	/*  stop here, the file is fine */
+	ChunkFailed		=	3,	/*  stop here, the file is broken */
+	ChunkSkipped		=	4,	/*  not parsed, go on with the next one */
+}
+ChunkResult;
+
+/*  The checksum of the header, string and template tables, and in *recordsValid the one of the records */
+bool	CheckChunkChecksums(const uint8_t* chunk, bool* recordsValid)
+{
+	const EvtxChunkHeader*	chunkHeader	=	reinterpret_cast<const EvtxChunkHeader*>(chunk);
+	uint32_t		crc;
+
+	crc = Crc32(0, chunk, offsetof(EvtxChunkHeader, flags));
+	crc = Crc32(crc, chunk + offsetof(EvtxChunkHeader, stringTable), sizeof(EvtxChunkHeader) - offsetof(EvtxChunkHeader, stringTable));
+	if ( crc != chunkHeader->checksum )
+		return false;
+
+	*recordsValid = ( chunkHeader->freeSpaceOffset >= sizeof(EvtxChunkHeader) && chunkHeader->freeSpaceOffset <= EVTX_CHUNK_SIZE &&
+		Crc32(0, chunk + sizeof(EvtxChunkHeader), chunkHeader->freeSpaceOffset - sizeof(EvtxChunkHeader)) == chunkHeader->recordsChecksum );
+	return true;
+}
+
+/*  --carve: a record of a dirty chunk is only parsed if its header and the copy of its size at its end agree */
+bool	IsIntactRecord(const uint8_t* chunk, uint64_t chunkSize, uint64_t off)
+{
+	const EvtxRecordHeader*	recordHeader	=	reinterpret_cast<const EvtxRecordHeader*>(chunk + off);
+	uint32_t		sizeCopy;
+
+	if ( off + sizeof(*recordHeader) > chunkSize || recordHeader->magic != 0x00002a2a ||
+			recordHeader->size < sizeof(*recordHeader) + sizeof(sizeCopy) || recordHeader->size > chunkSize - off )
+		return false;
+	memcpy(&sizeCopy, chunk + off + recordHeader->size - sizeof(sizeCopy), sizeof(sizeCopy));
+	return sizeCopy == recordHeader->size;
+}
+
+/*  The next intact record at or after off, chunkSize if there is none */
+uint64_t	FindIntactRecord(const uint8_t* chunk, uint64_t chunkSize, uint64_t off)
+{
+	while ( off + sizeof(EvtxRecordHeader) <= chunkSize )
+	{
+		const uint8_t*	hit	=	(const uint8_t*)memchr(chunk + off, '*', chunkSize - off);
+
+		if ( hit == NULL )
+			break;
+		off = hit - chunk;
+		if ( IsIntactRecord(chunk, chunkSize, off) )
+			return off;
+		off++;
+	}
+	return chunkSize;
+}
+
+ChunkResult	ParseChunk(WorkerContext* worker, const uint8_t* chunk, uint64_t chunkSize, uint64_t off)
+{
+	const EvtxChunkHeader*	chunkHeader	=	reinterpret_cast<const EvtxChunkHeader*>(chunk);
+	OutputBuffer&		out		=	worker->out;
+	RecordEmitter&		emit		=	*worker->emitter;
+	const RecordFilter&	filter		=	*worker->filter;
+
+	worker->ResetChunk();
+	ResetIndexEntry(&worker->indexEntry);
+	worker->lastRecord = 0;
+
+	if ( memcmp(chunkHeader->magic, EVTX_CHUNK_HEADER_MAGIC, sizeof(EVTX_CHUNK_HEADER_MAGIC)) )
+		return ChunkEndOfFile;
+
+	if ( worker->verifying )
+	{
+		bool	recordsValid;
+		bool	headerValid	=	CheckChunkChecksums(chunk, &recordsValid);
+
+		if ( !headerValid || !recordsValid )
+		{
+			char	message[128];
+
+			snprintf(message, sizeof(message), "Chunk at offset %" PRIu64 " fails the %s checksum, skipped\n", off, headerValid ? "records" : "header");
+			emit.Message(out, message);
+			STATS_ADD(worker, chunksUnverified, 1);
+			return ChunkSkipped;
+		}
+		STATS_ADD(worker, chunksVerified, 1);
+	}
+
+	if ( !filter.MatchesChunk(chunkHeader->firstRecordNumber, chunkHeader->lastRecordNumber) )
+	{
+		STATS_ADD(worker, chunksSkipped, 1);
+		return ChunkSkipped;
+	}
+
+	// printf("Chunk %" PRIu64 " .. %" PRIu64 "\n", chunkHeader->firstRecordNumber, chunkHeader->lastRecordNumber);
+
+	uint64_t inRecordOff = sizeof(*chunkHeader);
+	/*  the header checksum matched when salvaging, so its end of the records can be trusted */
+	uint64_t recordsEnd = worker->salvaging ? std::min<uint64_t>(chunkSize, chunkHeader->freeSpaceOffset) : chunkSize;
+
+	while ( 1 )
+	{
+		const EvtxRecordHeader*	recordHeader	=	reinterpret_cast<const EvtxRecordHeader*>(chunk + inRecordOff);
+		size_t			recordStart;
+		bool			parsed;
+
+		if ( inRecordOff + sizeof(*recordHeader) > chunkSize )
+			break;
+
+		if ( worker->salvaging && !IsIntactRecord(chunk, recordsEnd, inRecordOff) )
+		{
+			if ( inRecordOff >= recordsEnd )
+				break;
+			STATS_ADD(worker, recordsSalvaged, 1);
+			inRecordOff = FindIntactRecord(chunk, recordsEnd, inRecordOff + 1);
+			continue;
+		}
+
+		if ( recordHeader->magic != 0x00002a2a )
+		{
+#ifdef PRINT_TAGS
+			printf("Record header mismatch at %08X\n", (uint32_t)(off + inRecordOff));
+#endif
+			break;
+		}
+
+		if ( !filter.MatchesRecord(recordHeader->number, recordHeader->timestamp) )
+		{
+			STATS_ADD(worker, recordsFiltered, 1);
+			if ( recordHeader->size < sizeof(*recordHeader) )
+				break;
+			inRecordOff += recordHeader->size;
+			continue;
+		}
+
+		if ( worker->indexing )
+			IndexEntryAddRecord(&worker->indexEntry, recordHeader->number, recordHeader->timestamp);
+
+		recordStart = out.Size();
+		worker->eventIDPending = filter.HasEventIDs() || worker->indexing;
+		worker->recordFiltered = false;
+		emit.BeginRecord(out, recordHeader->number, recordHeader->timestamp, worker->recordTime);
+
+		parsed = ParseBinXmlPre(worker, chunk, chunkSize, off, inRecordOff + sizeof(*recordHeader));
+
+		if ( worker->recordFiltered || ( parsed && worker->eventIDPending ) )
+		{
+			/*  not wanted, or has no EventID at all */
+			STATS_ADD(worker, recordsFiltered, 1);
+			out.Truncate(recordStart);
+			if ( recordHeader->size < sizeof(*recordHeader) )
+				break;
+			inRecordOff += recordHeader->size;
+			continue;
+		}
+
+		if ( !parsed )
+		{
+			worker->indexEntry.flags |= EVTX_INDEX_INCOMPLETE;
+			STATS_ADD(worker, recordsFailed, 1);
+			STATS_ADD(worker, chunksWithFailures, 1);
+			emit.AbortRecord(out);
+			if ( worker->salvaging )
+			{
+				/*  what was printed of it would run into the next record */
+				out.Truncate(recordStart);
+				inRecordOff += recordHeader->size;
+				continue;
+			}
+			if ( worker->merging )
+				worker->recordKeys.push_back(MergeKey{ recordStart, recordHeader->number, recordHeader->timestamp });
+			if ( recordHeader->number >= chunkHeader->firstRecordNumber &&
+					recordHeader->number <= chunkHeader->lastRecordNumber )
+			{
+				return ChunkFailed;
+			}
+			break;
+		}
+		emit.EndRecord(out);
+		if ( worker->merging )
+			worker->recordKeys.push_back(MergeKey{ recordStart, recordHeader->number, recordHeader->timestamp });
+		STATS_ADD(worker, recordsPrinted, 1);
+		worker->lastRecord = std::max(worker->lastRecord, recordHeader->number);
+
+		inRecordOff += recordHeader->size;
+	}
+
+	if ( inRecordOff > off + chunkSize )
+		return ChunkFailed;
+
+	return ChunkParsed;
+}
+
+#ifdef _WIN32
+#define lseek64 _lseeki64
+#endif
+#ifdef __MACH__
+static_assert(sizeof(off_t) == 8, "Unsupported lseek() implementation on Mach");
+#define lseek64 lseek
+#endif
+
+typedef enum
+{
+	ReadOK		=	1,
+	ReadShort	=	2,
+	ReadError	=	3,
+}
+ReadResult;
+
+/*  Compressed inputs, told apart by their magic */
+typedef enum
+{
+	CompressionNone		=	0,
+	CompressionGzip		=	1,
+	CompressionZstd		=	2,
+	CompressionLz4		=	3,
+}
+CompressionFormat;
+
+CompressionFormat	DetectCompression(int f)
+{
+	uint8_t		magic[4];
+	bool		haveMagic	=	( read(f, magic, sizeof(magic)) == sizeof(magic) );
+
+	lseek64(f, 0, SEEK_SET);
+	if ( !haveMagic )
+		return CompressionNone;
+	if ( magic[0] == 0x1F && magic[1] == 0x8B )
+		return CompressionGzip;
+	if ( !memcmp(magic, "\x28\xB5\x2F\xFD", sizeof(magic)) )
+		return CompressionZstd;
+	if ( !memcmp(magic, "\x04\x22\x4D\x18", sizeof(magic)) )
+		return CompressionLz4;
+	return CompressionNone;
+}
+
+/*  The bytes of the file front to back, as the thread of a ChunkStream reads them */
+class ByteSource {
+public:
+	virtual ~ByteSource() {}
+
+	/*  Up to len bytes, 0 at the end of the stream, -1 if it is broken */
+	virtual int64_t	Read(uint8_t* data, size_t len) = 0;
+};
+
+#define DECOMPRESS_INPUT_SIZE	0x40000
+
+/*  Reads the compressed file from where it is and hands out what it decompresses to */
+class Decompressor : public ByteSource {
+public:
+	Decompressor(int file) : f(file), input(DECOMPRESS_INPUT_SIZE), inputPos(0), inputLen(0), broken(false) {}
+
+protected:
+	/*  Once the previous input is used up; false at the end of the file */
+	bool	FillInput() {
+		int64_t		got	=	read(f, &input[0], input.size());
+
+		if ( got <= 0 )
+			return false;
+		inputPos = 0;
+		inputLen = got;
+		return true;
+	}
+
+	int64_t	Produced(size_t len) const {
+		return ( len == 0 && broken ) ? -1 : (int64_t)len;
+	}
+
+	int			f;
+	std::vector<uint8_t>	input;
+	size_t			inputPos;
+	size_t			inputLen;
+	bool			broken;		/*  what came before the error is still handed out */
+};
+
+#ifdef PARSE_EVTX_ZLIB
+class GzipDecompressor : public Decompressor {
+public:
+	GzipDecompressor(int file) : Decompressor(file) {
+		memset(&stream, 0, sizeof(stream));
+		broken = ( inflateInit2(&stream, 15 + 32) != Z_OK );	/*  gzip or zlib headers */
+	}
+
+	~GzipDecompressor() {
+		inflateEnd(&stream);
+	}
+
+	int64_t	Read(uint8_t* data, size_t len) {
+		stream.next_out = data;
+		stream.avail_out = len;
+		while ( stream.avail_out > 0 && !broken )
+		{
+			if ( stream.avail_in == 0 )
+			{
+				if ( !FillInput() )
+					break;
+				stream.next_in = &input[0];
+				stream.avail_in = inputLen;
+			}
+
+			int	result	=	inflate(&stream, Z_NO_FLUSH);
+
+			if ( result == Z_STREAM_END )
+				broken = ( inflateReset(&stream) != Z_OK );	/*  another member may follow, as after cat a.gz b.gz */
+			else if ( result != Z_OK && !( result == Z_BUF_ERROR && stream.avail_in == 0 ) )
+				broken = true;
+		}
+		return Produced(len - stream.avail_out);
+	}
+
+private:
+	z_stream	stream;
+};
+#endif
+
+#ifdef PARSE_EVTX_ZSTD
+class ZstdDecompressor : public Decompressor {
+public:
+	ZstdDecompressor(int file) : Decompressor(file), stream(ZSTD_createDStream()) {
+		broken = ( stream == NULL || ZSTD_isError(ZSTD_initDStream(stream)) );
+	}
+
+	~ZstdDecompressor() {
+		ZSTD_freeDStream(stream);
+	}
+
+	int64_t	Read(uint8_t* data, size_t len) {
+		ZSTD_outBuffer	output	=	{ data, len, 0 };
+
+		while ( output.pos < output.size && !broken )
+		{
+			if ( inputPos == inputLen && !FillInput() )
+				break;
+
+			ZSTD_inBuffer	in	=	{ &input[0], inputLen, inputPos };
+
+			broken = ZSTD_isError(ZSTD_decompressStream(stream, &output, &in));
+			inputPos = in.pos;
+		}
+		return Produced(output.pos);
+	}
+
+private:
+	ZSTD_DStream*	stream;
+};
+#endif
+
+#ifdef PARSE_EVTX_LZ4
+class Lz4Decompressor : public Decompressor {
+public:
+	Lz4Decompressor(int file) : Decompressor(file), context(NULL) {
+		broken = LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION));
+	}
+
+	~Lz4Decompressor() {
+		if ( context != NULL )
+			LZ4F_freeDecompressionContext(context);
+	}
+
+	int64_t	Read(uint8_t* data, size_t len) {
+		size_t		produced	=	0;
+
+		while ( produced < len && !broken )
+		{
+			if ( inputPos == inputLen && !FillInput() )
+				break;
+
+			size_t	outLen	=	len - produced;
+			size_t	inLen	=	inputLen - inputPos;
+
+			broken = LZ4F_isError(LZ4F_decompress(context, data + produced, &outLen, &input[inputPos], &inLen, NULL));
+			produced += outLen;
+			inputPos += inLen;
+		}
+		return Produced(produced);
+	}
+
+private:
+	LZ4F_dctx*	context;
+};
+#endif
+
+/*  NULL if this build can't read the format */
+Decompressor*	CreateDecompressor(int f, CompressionFormat format)
+{
+	(void)f;
+	switch ( format )
+	{
+#ifdef PARSE_EVTX_ZLIB
+	case CompressionGzip:
+		return new GzipDecompressor(f);
+#endif
+#ifdef PARSE_EVTX_ZSTD
+	case CompressionZstd:
+		return new ZstdDecompressor(f);
+#endif
+#ifdef PARSE_EVTX_LZ4
+	case CompressionLz4:
+		return new Lz4Decompressor(f);
+#endif
+	default:
+		return NULL;
+	}
+}
+
+#define READ_AHEAD_MAX_CHUNKS	4096
+
+/*  --no-mmap: plain reads of the file, one after the other */
+class FileSource : public ByteSource {
+public:
+	FileSource(int file) : f(file) {}
+
+	int64_t	Read(uint8_t* data, size_t len) {
+		int64_t		got	=	read(f, data, len);
+
+		return ( got < 0 ) ? -1 : got;
+	}
+
+private:
+	int		f;
+};
+
+#ifdef PARSE_EVTX_IO_URING
+#define READ_AHEAD_BLOCK_SIZE	EVTX_CHUNK_SIZE
+
+/*  Keeps a read of the next queueDepth blocks of the file in flight with io_uring and hands the blocks out in file
+ *  order as they complete. Set up with the system calls themselves, so that there is no liburing to depend on */
+class UringFileSource : public ByteSource {
+public:
+	UringFileSource(int file, unsigned queueDepth) : f(file), ring(-1), blocks(queueDepth), vectors(queueDepth), results(queueDepth, 0), done(queueDepth, false),
+		slotBlocks(queueDepth, 0), filled(queueDepth, 0), nextSubmit(0), nextBlock(0), endBlock(UINT64_MAX), numInFlight(0), current(0), blockPos(0), blockLen(0), broken(false),
+		sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes(MAP_FAILED), sqRingSize(0), cqRingSize(0), sqesSize(0) {}
+
+	~UringFileSource() {
+		/*  the kernel writes into the blocks until their reads complete */
+		while ( numInFlight > 0 && Reap() )
+			;
+		if ( sqes != MAP_FAILED )
+			munmap(sqes, sqesSize);
+		if ( cqRing != MAP_FAILED )
+			munmap(cqRing, cqRingSize);
+		if ( sqRing != MAP_FAILED )
+			munmap(sqRing, sqRingSize);
+		if ( ring >= 0 )
+			close(ring);
+	}
+
+	/*  false where the kernel has no io_uring or won't let us use it, the file is then read with a FileSource */
+	bool	Start() {
+		struct io_uring_params	params;
+
+		memset(&params, 0, sizeof(params));
+		ring = syscall(__NR_io_uring_setup, (unsigned)blocks.size(), &params);
+		if ( ring < 0 )
+			return false;
+
+		sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+		cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+		sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+		cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+		sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+		if ( sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED )
+			return false;
+
+		sqTail = (uint32_t*)( (uint8_t*)sqRing + params.sq_off.tail );
+		sqMask = *(uint32_t*)( (uint8_t*)sqRing + params.sq_off.ring_mask );
+		sqArray = (uint32_t*)( (uint8_t*)sqRing + params.sq_off.array );
+		cqHead = (uint32_t*)( (uint8_t*)cqRing + params.cq_off.head );
+		cqTail = (uint32_t*)( (uint8_t*)cqRing + params.cq_off.tail );
+		cqMask = *(uint32_t*)( (uint8_t*)cqRing + params.cq_off.ring_mask );
+		cqes = (struct io_uring_cqe*)( (uint8_t*)cqRing + params.cq_off.cqes );
+
+		for (size_t slot = 0; slot < blocks.size() && !broken; slot++)
+		{
+			blocks[slot].resize(READ_AHEAD_BLOCK_SIZE);
+			Submit(slot);
+		}
+		return !broken;
+	}
+
+	int64_t	Read(uint8_t* data, size_t len) {
+		while ( blockPos == blockLen )
+		{
+			size_t		slot	=	nextBlock % blocks.size();
+
+			if ( broken || nextBlock >= endBlock )
+				return broken ? -1 : 0;
+			while ( !done[slot] && !broken )
+				broken = !Reap();
+			if ( !broken && ( results[slot] == -EINTR || results[slot] == -EAGAIN ) )
+			{
+				Queue(slot);
+				continue;
+			}
+			if ( broken || results[slot] < 0 )
+			{
+				broken = true;
+				return -1;
+			}
+			done[slot] = false;
+			filled[slot] += results[slot];
+			if ( results[slot] > 0 && filled[slot] < READ_AHEAD_BLOCK_SIZE )
+			{
+				/*  a short read is not the end yet, network and FUSE file systems have them */
+				Queue(slot);
+				continue;
+			}
+			current = slot;
+			blockPos = 0;
+			blockLen = filled[slot];
+			if ( ++nextBlock, blockLen < READ_AHEAD_BLOCK_SIZE )
+				endBlock = nextBlock;	/*  read nothing, the reads in flight after it get nothing either */
+		}
+
+		size_t		n	=	std::min(len, blockLen - blockPos);
+
+		memcpy(data, &blocks[current][blockPos], n);
+		blockPos += n;
+		if ( blockPos == blockLen && nextSubmit < endBlock )
+			Submit(current);
+		return n;
+	}
+
+private:
+	/*  Block nextSubmit goes into the slot of the block queueDepth before it */
+	void	Submit(size_t slot) {
+		slotBlocks[slot] = nextSubmit++;
+		filled[slot] = 0;
+		Queue(slot);
+	}
+
+	/*  Reads what is still missing of the block of the slot */
+	void	Queue(size_t slot) {
+		uint32_t		tail	=	*sqTail;
+		uint32_t		idx	=	tail & sqMask;
+		struct io_uring_sqe*	sqe	=	(struct io_uring_sqe*)sqes + idx;
+
+		done[slot] = false;
+		vectors[slot].iov_base = &blocks[slot][filled[slot]];
+		vectors[slot].iov_len = READ_AHEAD_BLOCK_SIZE - filled[slot];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = f;
+		sqe->off = slotBlocks[slot] * READ_AHEAD_BLOCK_SIZE + filled[slot];
+		sqe->addr = (uint64_t)(uintptr_t)&vectors[slot];
+		sqe->len = 1;
+		sqe->user_data = slot;
+		sqArray[idx] = idx;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+		if ( Enter(1, 0, 0) != 1 )
+		{
+			broken = true;
+			return;
+		}
+		numInFlight++;
+	}
+
+	/*  Waits for at least one read to complete */
+	bool	Reap() {
+		if ( Enter(0, 1, IORING_ENTER_GETEVENTS) < 0 )
+			return false;
+
+		uint32_t	head	=	*cqHead;
+
+		for (; head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE); head++)
+		{
+			const struct io_uring_cqe&	cqe	=	cqes[head & cqMask];
+
+			results[cqe.user_data] = cqe.res;
+			done[cqe.user_data] = true;
+			numInFlight--;
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	int	Enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+		int	result;
+
+		while ( ( result = syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, NULL, 0) ) < 0 && errno == EINTR )
+			;
+		return result;
+	}
+
+	int				f;
+	int				ring;
+	std::vector<std::vector<uint8_t> >	blocks;
+	std::vector<struct iovec>	vectors;
+	std::vector<int32_t>		results;	/*  bytes read or -errno, once done */
+	std::vector<bool>		done;
+	std::vector<uint64_t>		slotBlocks;	/*  the block every slot is reading */
+	std::vector<size_t>		filled;		/*  bytes of it read so far */
+	uint64_t			nextSubmit;
+	uint64_t			nextBlock;	/*  the next one to hand out */
+	uint64_t			endBlock;	/*  known once a read comes back short */
+	size_t				numInFlight;
+	size_t				current;	/*  the slot being handed out */
+	size_t				blockPos;
+	size_t				blockLen;
+	bool				broken;
+
+	void*				sqRing;
+	void*				cqRing;
+	void*				sqes;
+	size_t				sqRingSize;
+	size_t				cqRingSize;
+	size_t				sqesSize;
+	uint32_t*			sqTail;
+	uint32_t			sqMask;
+	uint32_t*			sqArray;
+	uint32_t*			cqHead;
+	uint32_t*			cqTail;
+	uint32_t			cqMask;
+	struct io_uring_cqe*		cqes;
+};
+#endif
+
+/*  Reads ahead with io_uring where there is one, otherwise with plain reads on the thread of the ChunkStream */
+ByteSource*	CreateFileSource(int f, unsigned readAhead)
+{
+#ifdef PARSE_EVTX_IO_URING
+	UringFileSource*	source	=	new UringFileSource(f, readAhead);
+
+	if ( source->Start() )
+		return source;
+	delete source;
+#else
+	(void)readAhead;
+#endif
+	return new FileSource(f);
+}
+
+/*  Reads or decompresses on a thread of its own into a ring of buffers: the file header first, then one chunk each.
+ *  The workers take the parts in about the order of the file, each one once, and a buffer is reused when
+ *  all the parts before it were taken too */
+class ChunkStream {
+public:
+	ChunkStream(ByteSource* byteSource, size_t numBuffers) : source(byteSource), buffers(numBuffers), lengths(numBuffers, 0), taken(numBuffers, false),
+		firstPart(0), numProduced(0), finished(false), broken(false), stopping(false) {
+		producer = std::thread(&ChunkStream::Produce, this);
+	}
+
+	~ChunkStream() {
+		{
+			std::lock_guard<std::mutex>	lock(ringLock);
+
+			stopping = true;
+		}
+		changed.notify_all();
+		producer.join();
+	}
+
+	/*  Only the header and whole chunks, the way the scheduler reads them */
+	ReadResult	Read(uint64_t off, uint64_t len, const uint8_t** result, std::vector<uint8_t>& buffer) {
+		uint64_t			part;
+		std::unique_lock<std::mutex>	lock(ringLock);
+
+		if ( !PartAt(off, len, &part) )
+			return ReadError;
+		changed.wait(lock, [&]{ return part < numProduced || finished; });
+		if ( part >= numProduced )
+			return broken ? ReadError : ReadShort;
+		if ( part < firstPart || taken[part % buffers.size()] )
+			return ReadError;
+
+		size_t		slot	=	part % buffers.size();
+
+		if ( lengths[slot] == len )
+		{
+			buffer.assign(buffers[slot].begin(), buffers[slot].begin() + len);
+			*result = &buffer[0];
+		}
+		Take(slot);
+		return ( lengths[slot] == len ) ? ReadOK : ( broken ? ReadError : ReadShort );
+	}
+
+	/*  A chunk the index let the scheduler skip */
+	void	Skip(uint64_t off, uint64_t len) {
+		uint64_t			part;
+		std::unique_lock<std::mutex>	lock(ringLock);
+
+		if ( !PartAt(off, len, &part) )
+			return;
+		changed.wait(lock, [&]{ return part < numProduced || finished; });
+		if ( part < numProduced && part >= firstPart && !taken[part % buffers.size()] )
+			Take(part % buffers.size());
+	}
+
+private:
+	bool	PartAt(uint64_t off, uint64_t len, uint64_t* part) const {
+		if ( off == 0 && len == sizeof(EvtxHeader) )
+			*part = 0;
+		else if ( off >= sizeof(EvtxHeader) && ( off - sizeof(EvtxHeader) ) % EVTX_CHUNK_SIZE == 0 && len == EVTX_CHUNK_SIZE )
+			*part = 1 + ( off - sizeof(EvtxHeader) ) / EVTX_CHUNK_SIZE;
+		else
+			return false;
+		return true;
+	}
+
+	/*  Under ringLock */
+	void	Take(size_t slot) {
+		taken[slot] = true;
+		while ( firstPart < numProduced && taken[firstPart % buffers.size()] )
+		{
+			taken[firstPart % buffers.size()] = false;
+			firstPart++;
+		}
+		changed.notify_all();
+	}
+
+	void	Produce() {
+		for (uint64_t part = 0; ; part++)
+		{
+			size_t		slot	=	part % buffers.size();
+			size_t		len	=	( part == 0 ) ? sizeof(EvtxHeader) : EVTX_CHUNK_SIZE;
+			size_t		got	=	0;
+			int64_t		n	=	0;
+
+			{
+				std::unique_lock<std::mutex>	lock(ringLock);
+
+				changed.wait(lock, [&]{ return stopping || part < firstPart + buffers.size(); });
+				if ( stopping )
+					return;
+			}
+
+			/*  no one looks at the slot until numProduced covers it */
+			buffers[slot].resize(len);
+			while ( got < len && ( n = source->Read(&buffers[slot][got], len - got) ) > 0 )
+				got += n;
+
+			{
+				std::lock_guard<std::mutex>	lock(ringLock);
+
+				lengths[slot] = got;
+				if ( got > 0 )
+					numProduced++;
+				if ( got < len )
+				{
+					finished = true;
+					broken = ( n < 0 );
+				}
+			}
+			changed.notify_all();
+			if ( got < len )
+				return;
+		}
+	}
+
+	std::unique_ptr<ByteSource>		source;
+	std::vector<std::vector<uint8_t> >	buffers;
+	std::vector<size_t>			lengths;
+	std::vector<bool>			taken;
+	uint64_t				firstPart;	/*  the oldest one still in the ring */
+	uint64_t				numProduced;
+	bool					finished;	/*  the stream ended, or broke if broken is set */
+	bool					broken;
+	bool					stopping;
+	std::mutex				ringLock;
+	std::condition_variable			changed;
+	std::thread				producer;
+};
+
+/*  Hands out pointers straight into a read-only mapping of the file, or reads into the caller's buffer if it can't be mapped.
+ *  A compressed file, or one read ahead, goes through a ChunkStream instead */
+class InputFile {
+public:
+	InputFile(int file) : f(file), base(NULL), size(0), owned(false) {
+#ifdef _WIN32
+		mapping = NULL;
+#endif
+	}
+
+	/*  EvtxParseBuffer(): the caller's memory, used as if it were a mapping */
+	InputFile(const uint8_t* data, uint64_t dataSize) : f(-1), base(data), size(dataSize), owned(false) {
+#ifdef _WIN32
+		mapping = NULL;
+#endif
+	}
+
+	~InputFile() {
+		Unmap();
+	}
+
+	/*  Takes the source, the file is not to be mapped */
+	void	ReadAhead(ByteSource* source, size_t numBuffers) {
+		stream.reset(new ChunkStream(source, numBuffers));
+	}
+
+	bool	Map() {
+#ifdef _WIN32
+		HANDLE		h	=	(HANDLE)_get_osfhandle(f);
+		LARGE_INTEGER	fileSize;
+
+		if ( h == INVALID_HANDLE_VALUE || !GetFileSizeEx(h, &fileSize) || fileSize.QuadPart == 0 )
+			return false;
+		if ( (uint64_t)fileSize.QuadPart != (uint64_t)(size_t)fileSize.QuadPart )
+			return false;	/*  does not fit the address space */
+		mapping = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL);
+		if ( mapping == NULL )
+			return false;
+		base = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if ( base == NULL )
+		{
+			CloseHandle(mapping);
+			mapping = NULL;
+			return false;
+		}
+		size = fileSize.QuadPart;
+		owned = true;
+#else
+		struct stat	st;
+		void*		p;
+
+		if ( fstat(f, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 )
+			return false;
+		if ( (uint64_t)st.st_size != (uint64_t)(size_t)st.st_size )
+			return false;	/*  does not fit the address space */
+		p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+		if ( p == MAP_FAILED )
+			return false;
+		base = (const uint8_t*)p;
+		size = st.st_size;
+		owned = true;
+		madvise(p, size, MADV_SEQUENTIAL);
+#endif
+		return true;
+	}
+
+	bool	IsMapped() const {
+		return base != NULL;
+	}
+
+	/*  Of the mapping or the buffer, otherwise where the file or the device ends */
+	uint64_t	Size() {
+		if ( base != NULL )
+			return size;
+
+		std::lock_guard<std::mutex>	lock(readLock);
+		int64_t				end	=	lseek64(f, 0, SEEK_END);
+
+		return ( end > 0 ) ? end : 0;
+	}
+
+	/*  Tell the kernel we are about to need this range */
+	void	Prefetch(uint64_t off, uint64_t len) const {
+#ifndef _WIN32
+		if ( base == NULL || off >= size )
+			return;
+		if ( len > size - off )
+			len = size - off;
+		madvise((void*)(base + off), len, MADV_WILLNEED);
+#endif
+	}
+
+	ReadResult	Read(uint64_t off, uint64_t len, const uint8_t** result, std::vector<uint8_t>& buffer) {
+		if ( stream )
+			return stream->Read(off, len, result, buffer);
+		if ( base != NULL )
+		{
+			if ( off > size || len > size - off )
+				return ReadShort;
+			*result = base + off;
+			return ReadOK;
+		}
+
+		std::lock_guard<std::mutex>	lock(readLock);
+
+		buffer.resize(len);
+		if ( lseek64(f, off, SEEK_SET) != off )
+			return ReadError;
+		if ( read(f, &buffer[0], len) != len )
+			return ReadShort;
+		*result = &buffer[0];
+		return ReadOK;
+	}
+
+	/*  Will not be read, a stream can let go of it */
+	void	Skip(uint64_t off, uint64_t len) {
+		if ( stream )
+			stream->Skip(off, len);
+	}
+
+private:
+	void	Unmap() {
+		if ( base == NULL || !owned )
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+		CloseHandle(mapping);
+		mapping = NULL;
+#else
+		munmap((void*)base, size);
+#endif
+		base = NULL;
+		owned = false;
+	}
+
+	int		f;
+	const uint8_t*	base;
+	uint64_t	size;
+	bool		owned;		/*  mapped by Map(), not the caller's buffer */
+#ifdef _WIN32
+	HANDLE		mapping;
+#endif
+	std::mutex	readLock;
+	std::unique_ptr<ChunkStream>	stream;
+};
+
+/*  --stats: the workers of all files add their counters here when they are done */
+class StatsCollector {
+public:
+	StatsCollector() : startTime(StatsNow()) {}
+
+	void	Add(const ParseStats& stats) {
+		std::lock_guard<std::mutex>	lock(statsLock);
+
+		total.Add(stats);
+	}
+
+	void	Print(FILE* out) const {
+		double		wallTime	=	( StatsNow() - startTime ) / 1e9;
+		uint64_t	records		=	total.recordsPrinted + total.recordsFiltered + total.recordsFailed;
+
+		fprintf(out, "chunks:    %llu parsed, %llu skipped, %llu failed, %llu with bad records\n",
+			(unsigned long long)total.chunksParsed, (unsigned long long)total.chunksSkipped,
+			(unsigned long long)total.chunksFailed, (unsigned long long)total.chunksWithFailures);
+		if ( total.chunksVerified + total.chunksUnverified != 0 )
+			fprintf(out, "verified:  %llu chunks, %llu skipped with a bad checksum\n",
+				(unsigned long long)total.chunksVerified, (unsigned long long)total.chunksUnverified);
+		if ( total.chunksCarved != 0 )
+			fprintf(out, "carved:    %llu chunks, %llu with a bad records checksum, %llu corrupt records skipped\n",
+				(unsigned long long)total.chunksCarved, (unsigned long long)total.chunksDirty, (unsigned long long)total.recordsSalvaged);
+		fprintf(out, "records:   %llu printed, %llu filtered, %llu failed\n",
+			(unsigned long long)total.recordsPrinted, (unsigned long long)total.recordsFiltered, (unsigned long long)total.recordsFailed);
+		fprintf(out, "templates: %llu hits, %llu definitions parsed, %llu taken from earlier chunks\n",
+			(unsigned long long)total.templateHits, (unsigned long long)total.templateMisses, (unsigned long long)total.templateCacheHits);
+		fprintf(out, "arguments: %llu not substituted\n", (unsigned long long)total.argumentsSkipped);
+		for (unsigned type = 0; type < 256; type++)
+		{
+			if ( total.argumentCount[type] != 0 )
+				fprintf(out, "  type 0x%02X: %llu values, %llu bytes\n", type,
+					(unsigned long long)total.argumentCount[type], (unsigned long long)total.argumentBytes[type]);
+		}
+		fprintf(out, "time:      %.3f s wall, %.3f s read, %.3f s parse (%.3f s in template definitions), %.3f s output\n",
+			wallTime, total.readTime / 1e9, total.parseTime / 1e9, total.templateTime / 1e9, total.outputTime / 1e9);
+		if ( wallTime > 0 )
+			fprintf(out, "rate:      %.0f records/s, %.1f MB/s in, %.1f MB/s out\n",
+				records / wallTime, total.bytesRead / wallTime / 1e6, total.bytesWritten / wallTime / 1e6);
+	}
+
+private:
+	uint64_t		startTime;
+	ParseStats		total;
+	mutable std::mutex	statsLock;
+};
+
+/*  --summarize: the tables of the workers of all files are added up here when they are done */
+class SummaryCollector {
+public:
+	void	SetKeys(const std::vector<std::string>& summaryKeys) {
+		keys = summaryKeys;
+	}
+
+	const std::vector<std::string>&	Keys() const {
+		return keys;
+	}
+
+	void	Add(const SummaryTable& table) {
+		std::lock_guard<std::mutex>	lock(summaryLock);
+
+		total.Add(table);
+	}
+
+	/*  A header line, then the count and the values of every group, tab separated; "-" if a record has no such value */
+	void	Print(FILE* out) const {
+		std::lock_guard<std::mutex>	lock(summaryLock);
+		auto				groups		=	total.Sorted();
+
+		fprintf(out, "Count");
+		for (auto& key : keys)
+			fprintf(out, "\t%s", key.c_str());
+		fprintf(out, "\n");
+		for (auto& group : groups)
+		{
+			size_t	pos	=	0;
+
+			fprintf(out, "%llu", (unsigned long long)group.count);
+			for (size_t idx = 0; idx < keys.size() && pos + sizeof(uint32_t) <= group.len; idx++)
+			{
+				uint32_t	len;
+
+				memcpy(&len, group.data + pos, sizeof(len));
+				pos += sizeof(len);
+				if ( len == UINT32_MAX )
+				{
+					fprintf(out, "\t-");
+					continue;
+				}
+				fprintf(out, "\t%.*s", (int)len, group.data + pos);
+				pos += len;
+			}
+			fprintf(out, "\n");
+		}
+	}
+
+private:
+	std::vector<std::string>	keys;
+	SummaryTable			total;
+	mutable std::mutex		summaryLock;
+};
+
+#define MERGE_RUN_BUFFER_SIZE	0x10000
+
+/*  --merge: the output of the records of all the inputs, in order. The records are held in memory up to the window size,
+ *  then sorted and spilled to a temporary file as a run; Finish() merges the runs in one pass. Text that is not part of
+ *  a record, such as a --verify message, goes with the record before it */
+class RecordMerger {
+public:
+	RecordMerger(EvtxMergeOrder mergeOrder, uint64_t windowSize) : order(mergeOrder), window(windowSize), inMemoryOnly(false), broken(false) {}
+
+	~RecordMerger() {
+		for (auto run : runs)
+			fclose(run);
+	}
+
+	/*  The output of one chunk of input inputIdx and its records; the chunks of an input come in file order */
+	void	Add(uint32_t inputIdx, const char* data, size_t len, const std::vector<MergeKey>& keys) {
+		std::lock_guard<std::mutex>	lock(mergeLock);
+
+		if ( inputIdx >= lastKeys.size() )
+		{
+			lastKeys.resize(inputIdx + 1, 0);
+			numRecords.resize(inputIdx + 1, 0);
+		}
+		/*  the text before the first record of the chunk still has the key of the input's record before it */
+		AddEntry(inputIdx, data, 0, keys.empty() ? len : keys[0].offset);
+		for (size_t idx = 0; idx < keys.size(); idx++)
+		{
+			lastKeys[inputIdx] = ( order == EvtxOrderTime ) ? keys[idx].timestamp : keys[idx].number;
+			AddEntry(inputIdx, data, keys[idx].offset, ( idx + 1 < keys.size() ) ? keys[idx + 1].offset : len);
+		}
+		if ( records.size() + entries.size() * sizeof(MergeEntry) > window )
+			Spill();
+	}
+
+	/*  After the last Add(); false if a run could not be written or read back */
+	bool	Finish(FILE* out) {
+		std::lock_guard<std::mutex>	lock(mergeLock);
+		std::vector<MergeRun>		sources;
+
+		std::sort(entries.begin(), entries.end(), MergeEntry::Before);
+		if ( runs.empty() )
+		{
+			for (auto& entry : entries)
+				fwrite(&records[entry.offset], 1, entry.len, out);
+			return !broken;
+		}
+
+		/*  a heap of the runs by their next record, the one still in memory included */
+		auto	after	=	[&](size_t a, size_t b) { return MergeEntry::Before(sources[b].entry, sources[a].entry); };
+		std::vector<size_t>	heap;
+
+		sources.resize(runs.size() + 1);
+		for (size_t idx = 0; idx < runs.size(); idx++)
+		{
+			sources[idx].file = runs[idx];
+			rewind(runs[idx]);
+			setvbuf(runs[idx], NULL, _IOFBF, MERGE_RUN_BUFFER_SIZE);
+		}
+		sources[runs.size()].file = NULL;
+		for (size_t idx = 0; idx < sources.size(); idx++)
+		{
+			if ( Next(sources[idx]) )
+				heap.push_back(idx);
+		}
+		std::make_heap(heap.begin(), heap.end(), after);
+		while ( !heap.empty() )
+		{
+			std::pop_heap(heap.begin(), heap.end(), after);
+
+			MergeRun&	source	=	sources[heap.back()];
+
+			fwrite(source.data, 1, source.entry.len, out);
+			if ( Next(source) )
+				std::push_heap(heap.begin(), heap.end(), after);
+			else
+				heap.pop_back();
+		}
+		return !broken;
+	}
+
+private:
+	/*  What a run file has in front of every record, and the in-memory list */
+	struct MergeEntry {
+		uint64_t	key;
+		uint64_t	sequence;	/*  in the input */
+		uint64_t	offset;		/*  in records, in memory only */
+		uint32_t	input;
+		uint32_t	len;
+
+		static bool	Before(const MergeEntry& a, const MergeEntry& b) {
+			if ( a.key != b.key )
+				return a.key < b.key;
+			if ( a.input != b.input )
+				return a.input < b.input;
+			return a.sequence < b.sequence;
+		}
+	};
+
+	/*  A run file being read back, or the records still in memory if file is NULL */
+	struct MergeRun {
+		MergeRun() : file(NULL), next(0), data(NULL) {}
+
+		FILE*			file;
+		size_t			next;		/*  of entries, without a file */
+		MergeEntry		entry;
+		std::vector<char>	buffer;
+		const char*		data;
+	};
+
+	/*  Under mergeLock, data[start..end) with the current key of the input */
+	void	AddEntry(uint32_t inputIdx, const char* data, size_t start, size_t end) {
+		MergeEntry	entry;
+
+		if ( end == start )
+			return;
+		entry.key = lastKeys[inputIdx];
+		entry.input = inputIdx;
+		entry.sequence = numRecords[inputIdx]++;
+		entry.offset = records.size();
+		entry.len = end - start;
+		entries.push_back(entry);
+		records.insert(records.end(), data + start, data + end);
+	}
+
+	/*  Under mergeLock */
+	void	Spill() {
+		if ( inMemoryOnly )
+			return;
+
+		FILE*	run	=	tmpfile();
+
+		if ( run == NULL )
+		{
+			fprintf(stderr, "Can't create a temporary file, --merge keeps everything in memory\n");
+			inMemoryOnly = true;
+			return;
+		}
+		std::sort(entries.begin(), entries.end(), MergeEntry::Before);
+		for (auto& entry : entries)
+		{
+			if ( fwrite(&entry, sizeof(entry), 1, run) != 1 || fwrite(&records[entry.offset], 1, entry.len, run) != entry.len )
+			{
+				broken = true;
+				break;
+			}
+		}
+		if ( fflush(run) != 0 )
+			broken = true;
+		runs.push_back(run);
+		entries.clear();
+		records.clear();
+	}
+
+	bool	Next(MergeRun& source) {
+		if ( source.file == NULL )
+		{
+			if ( source.next >= entries.size() )
+				return false;
+			source.entry = entries[source.next++];
+			source.data = &records[source.entry.offset];
+			return true;
+		}
+		if ( fread(&source.entry, sizeof(source.entry), 1, source.file) != 1 )
+			return false;
+		source.buffer.resize(source.entry.len);
+		if ( source.entry.len > 0 && fread(&source.buffer[0], 1, source.entry.len, source.file) != source.entry.len )
+		{
+			broken = true;
+			return false;
+		}
+		source.data = source.buffer.data();
+		return true;
+	}
+
+	EvtxMergeOrder		order;
+	uint64_t		window;
+	bool			inMemoryOnly;	/*  no temporary file could be created */
+	bool			broken;
+	std::vector<MergeEntry>	entries;	/*  of the records not spilled yet */
+	std::vector<char>	records;
+	std::vector<uint64_t>	lastKeys;	/*  of every input, for the text after its last record so far */
+	std::vector<uint64_t>	numRecords;
+	std::vector<FILE*>	runs;
+	std::mutex		mergeLock;
+};
+
+struct ParseOptions {
+	ParseOptions() : numThreads(1), useMmap(true), readAhead(0), format(EvtxFormatRaw), timePrecision(EvtxTimeSeconds), buildIndex(false), stats(NULL), templateCache(NULL), visitor(NULL), carve(false), verify(false),
+		mergeOrder(EvtxOrderTime), mergeWindow(0), merger(NULL), mergeInput(0), summary(NULL) {}
+	unsigned	numThreads;
+	bool		useMmap;
+	unsigned	readAhead;	/*  chunks read ahead of the workers when the file is not mapped, 0 to read them as they are parsed */
+	EvtxFormat	format;
+	EvtxTimePrecision	timePrecision;
+	RecordFilter	filter;
+	bool		buildIndex;
+	StatsCollector*	stats;		/*  --stats, NULL if not asked for */
+	TemplateCache*	templateCache;	/*  shared by all the files and workers, NULL to parse every definition */
+	FieldProjection	fields;
+	EvtxVisitor*	visitor;	/*  gets the values instead of the output, needs numThreads == 1 */
+	bool		carve;		/*  look for chunks anywhere in the input instead of reading it as a file */
+	bool		verify;		/*  check the file and chunk checksums */
+	EvtxMergeOrder	mergeOrder;
+	uint64_t	mergeWindow;
+	RecordMerger*	merger;		/*  EvtxMergeFiles(): the output goes there instead */
+	uint32_t	mergeInput;	/*  the number of the file among the ones merged */
+	SummaryCollector*	summary;	/*  --summarize: the records are counted there instead of printed, NULL to print them */
+};
+
+/*  Where --follow stopped, kept between the polls and in the checkpoint file */
+struct FollowState {
+	FollowState() : lastRecord(0), lastChunk(0) {}
+	uint64_t	lastRecord;	/*  the newest record printed */
+	uint64_t	lastChunk;	/*  the chunk it is in, the next poll starts there */
+};
+
+/*  --carve: where a chunk was found */
+struct CarvedChunk {
+	uint64_t	offset;
+	bool		intact;		/*  the records checksum matches as well */
+};
+
+/*  Arrow strings have to be valid UTF-8 and an ANSI string value need not be: str itself if it is, otherwise a copy
+ *  in scratch with U+FFFD for every invalid byte */
+const char*	ValidUtf8(const char* str, uint32_t* len, std::vector<char>& scratch)
+{
+	const uint8_t*	p	=	reinterpret_cast<const uint8_t*>(str);
+	size_t		pos	=	0;
+	size_t		seqLen;
+
+	while ( pos < *len && ( seqLen = Utf8SequenceLength(p + pos, *len - pos) ) != 0 )
+		pos += seqLen;
+	if ( pos == *len )
+		return str;
+
+	scratch.assign(str, str + pos);
+	while ( pos < *len )
+	{
+		seqLen = Utf8SequenceLength(p + pos, *len - pos);
+		if ( seqLen == 0 )
+		{
+			scratch.insert(scratch.end(), "\xEF\xBF\xBD", "\xEF\xBF\xBD" + 3);
+			pos++;
+			continue;
+		}
+		scratch.insert(scratch.end(), str + pos, str + pos + seqLen);
+		pos += seqLen;
+	}
+	*len = (uint32_t)scratch.size();
+	return &scratch[0];
+}
+
+/*  The values of a dictionary column of a stream, each one once */
+class ArrowDictionary {
+public:
+	ArrowDictionary() : offsets(1, 0), slots(64, -1), numWritten(0), written(false) {}
+
+	int32_t	Find(const char* str, uint32_t len) {
+		size_t	mask	=	slots.size() - 1;
+
+		for (size_t idx = Hash(str, len) & mask; ; idx = ( idx + 1 ) & mask)
+		{
+			int32_t	id	=	slots[idx];
+
+			if ( id < 0 )
+			{
+				id = (int32_t)( offsets.size() - 1 );
+				data.insert(data.end(), str, str + len);
+				offsets.push_back((int32_t)data.size());
+				slots[idx] = id;
+				if ( offsets.size() * 2 > slots.size() )
+					Rehash();
+				return id;
+			}
+			if ( (uint32_t)( offsets[id + 1] - offsets[id] ) == len && !memcmp(&data[offsets[id]], str, len) )
+				return id;
+		}
+	}
+
+	/*  Before a record batch: all of it the first time, then the values added since as a delta */
+	void	Write(ArrowStreamWriter& stream, int64_t id) {
+		size_t			size	=	offsets.size() - 1;
+		std::vector<int32_t>	newOffsets;
+		std::vector<int64_t>	nodes;
+		std::vector<ArrowBuffer>	buffers;
+
+		if ( written && numWritten == size )
+			return;
+		for (size_t idx = numWritten; idx <= size; idx++)
+			newOffsets.push_back(offsets[idx] - offsets[numWritten]);
+		nodes.push_back(size - numWritten);
+		nodes.push_back(0);
+		buffers.push_back(ArrowBuffer());
+		buffers.push_back(ArrowBuffer(&newOffsets[0], newOffsets.size() * sizeof(newOffsets[0])));
+		buffers.push_back(ArrowBuffer(data.data() + offsets[numWritten], offsets[size] - offsets[numWritten]));
+		stream.WriteDictionaryBatch(id, written, size - numWritten, nodes, buffers);
+		numWritten = size;
+		written = true;
+	}
+
+private:
+	static size_t	Hash(const char* str, uint32_t len) {
+		uint64_t	hash	=	0xcbf29ce484222325ULL;	/*  FNV-1a */
+
+		for (uint32_t idx = 0; idx < len; idx++)
+			hash = ( hash ^ (uint8_t)str[idx] ) * 0x100000001b3ULL;
+		return (size_t)hash;
+	}
+
+	void	Rehash() {
+		size_t	mask;
+
+		slots.assign(slots.size() * 2, -1);
+		mask = slots.size() - 1;
+		for (int32_t id = 0; id + 1 < (int32_t)offsets.size(); id++)
+		{
+			size_t	idx	=	Hash(&data[offsets[id]], offsets[id + 1] - offsets[id]) & mask;
+
+			while ( slots[idx] >= 0 )
+				idx = ( idx + 1 ) & mask;
+			slots[idx] = id;
+		}
+	}
+
+	std::vector<char>	data;
+	std::vector<int32_t>	offsets;	/*  of every value in data, and where the last one ends */
+	std::vector<int32_t>	slots;		/*  open addressing, -1 if free */
+	size_t			numWritten;
+	bool			written;
+};
+
+#define ARROW_BATCH_RECORDS	65536
+
+/*  The values of these keys become dictionary encoded columns of their own, the first time a record has them.
+ *  All the others go to the Fields list of (Key, Value) pairs, Key being dictionary encoded too */
+const struct {
+	const char*	column;
+	const char*	key;
+}
+arrowColumns[] =
+{
+	{ "Provider",	"Name" },	/*  the first Name is the one of <Provider> */
+	{ "Channel",	"Channel" },
+	{ "Computer",	"Computer" },
+	{ "EventID",	"EventID" },
+};
+
+#define ARROW_NUM_COLUMNS	( sizeof(arrowColumns) / sizeof(arrowColumns[0]) )
+#define ARROW_KEY_DICTIONARY	ARROW_NUM_COLUMNS
+
+/*  --format=arrow: the whole output of a file as one Arrow IPC stream, what the ArrowEmitter of the workers produced
+ *  is added in file order and written out as a record batch every ARROW_BATCH_RECORDS records */
+class ArrowBatchWriter {
+public:
+	ArrowBatchWriter(FILE* out) : stream(out), numRecords(0), valueOffsets(1, 0) {
+		stream.WriteSchema(Schema());
+	}
+
+	void	Append(const char* data, size_t len) {
+		const char*	end	=	data + len;
+
+		while ( data < end )
+		{
+			if ( *data == ARROW_ROW_RECORD )
+			{
+				uint64_t	number;
+				uint64_t	fileTime;
+
+				memcpy(&number, data + 1, sizeof(number));
+				memcpy(&fileTime, data + 1 + sizeof(number), sizeof(fileTime));
+				data += 1 + sizeof(number) + sizeof(fileTime);
+				recordNumbers.push_back(number);
+				timestamps.push_back((int64_t)( fileTime / 10 ) - 11644473600000000LL);	/*  microseconds since 1970 */
+				for (size_t column = 0; column < ARROW_NUM_COLUMNS; column++)
+					columns[column].push_back(-1);
+				fieldOffsets.push_back((int32_t)fieldKeys.size());
+				numRecords++;
+				continue;
+			}
+
+			uint32_t	keyLen;
+			uint32_t	valueLen;
+			const char*	key;
+			const char*	value;
+
+			memcpy(&keyLen, data + 1, sizeof(keyLen));
+			key = data + 1 + sizeof(keyLen);
+			memcpy(&valueLen, key + keyLen, sizeof(valueLen));
+			value = key + keyLen + sizeof(valueLen);
+			data = value + valueLen;
+			if ( numRecords == 0 )
+				continue;
+			value = ValidUtf8(value, &valueLen, valueScratch);
+			if ( !SetColumn(key, keyLen, value, valueLen) )
+			{
+				key = ValidUtf8(key, &keyLen, keyScratch);
+				fieldKeys.push_back(dictionaries[ARROW_KEY_DICTIONARY].Find(key, keyLen));
+				valueData.insert(valueData.end(), value, value + valueLen);
+				valueOffsets.push_back((int32_t)valueData.size());
+			}
+		}
+		if ( numRecords >= ARROW_BATCH_RECORDS )
+			WriteBatch();
+	}
+
+	void	Finish() {
+		if ( numRecords != 0 )
+			WriteBatch();
+		stream.WriteEnd();
+	}
+
+private:
+	static std::vector<ArrowField>	Schema() {
+		std::vector<ArrowField>	fields;
+		ArrowField		number("RecordNumber", ARROW_TYPE_INT);
+		ArrowField		timestamp("Timestamp", ARROW_TYPE_TIMESTAMP);
+		ArrowField		list("Fields", ARROW_TYPE_LIST);
+		ArrowField		item("item", ARROW_TYPE_STRUCT);
+		ArrowField		key("Key", ARROW_TYPE_UTF8);
+
+		number.bitWidth = 64;
+		timestamp.timeUnit = ARROW_TIME_MICROSECOND;
+		timestamp.timezone = "UTC";
+		fields.push_back(number);
+		fields.push_back(timestamp);
+		for (size_t column = 0; column < ARROW_NUM_COLUMNS; column++)
+		{
+			ArrowField	field(arrowColumns[column].column, ARROW_TYPE_UTF8, true);
+
+			field.dictionaryID = column;
+			fields.push_back(field);
+		}
+		key.dictionaryID = ARROW_KEY_DICTIONARY;
+		item.children.push_back(key);
+		item.children.push_back(ArrowField("Value", ARROW_TYPE_UTF8));
+		list.children.push_back(item);
+		fields.push_back(list);
+		return fields;
+	}
+
+	bool	SetColumn(const char* key, uint32_t keyLen, const char* value, uint32_t valueLen) {
+		for (size_t column = 0; column < ARROW_NUM_COLUMNS; column++)
+		{
+			if ( strlen(arrowColumns[column].key) != keyLen || memcmp(arrowColumns[column].key, key, keyLen) || columns[column].back() >= 0 )
+				continue;
+			columns[column].back() = dictionaries[column].Find(value, valueLen);
+			return true;
+		}
+		return false;
+	}
+
+	void	WriteBatch() {
+		std::vector<int64_t>		nodes;
+		std::vector<ArrowBuffer>	buffers;
+		std::vector<uint8_t>		validity[ARROW_NUM_COLUMNS];
+
+		for (size_t idx = 0; idx <= ARROW_KEY_DICTIONARY; idx++)
+			dictionaries[idx].Write(stream, idx);
+		fieldOffsets.push_back((int32_t)fieldKeys.size());
+
+		AddColumn(nodes, buffers, recordNumbers.size(), 0, ArrowBuffer(), ArrowBuffer(&recordNumbers[0], recordNumbers.size() * sizeof(recordNumbers[0])));
+		AddColumn(nodes, buffers, timestamps.size(), 0, ArrowBuffer(), ArrowBuffer(&timestamps[0], timestamps.size() * sizeof(timestamps[0])));
+		for (size_t column = 0; column < ARROW_NUM_COLUMNS; column++)
+		{
+			std::vector<int32_t>&	indices	=	columns[column];
+			size_t			nulls	=	0;
+
+			validity[column].assign(( indices.size() + 7 ) / 8, 0);
+			for (size_t idx = 0; idx < indices.size(); idx++)
+			{
+				if ( indices[idx] >= 0 )
+				{
+					validity[column][idx / 8] |= 1 << ( idx % 8 );
+					continue;
+				}
+				indices[idx] = 0;
+				nulls++;
+			}
+			AddColumn(nodes, buffers, indices.size(), nulls, ArrowBuffer(nulls != 0 ? &validity[column][0] : NULL, nulls != 0 ? validity[column].size() : 0),
+				ArrowBuffer(&indices[0], indices.size() * sizeof(indices[0])));
+		}
+		AddColumn(nodes, buffers, numRecords, 0, ArrowBuffer(), ArrowBuffer(&fieldOffsets[0], fieldOffsets.size() * sizeof(fieldOffsets[0])));
+		nodes.push_back(fieldKeys.size());	/*  the struct has no buffer but its validity */
+		nodes.push_back(0);
+		buffers.push_back(ArrowBuffer());
+		AddColumn(nodes, buffers, fieldKeys.size(), 0, ArrowBuffer(), ArrowBuffer(fieldKeys.empty() ? NULL : &fieldKeys[0], fieldKeys.size() * sizeof(fieldKeys[0])));
+		AddColumn(nodes, buffers, fieldKeys.size(), 0, ArrowBuffer(), ArrowBuffer(&valueOffsets[0], valueOffsets.size() * sizeof(valueOffsets[0])));
+		buffers.push_back(ArrowBuffer(valueData.empty() ? NULL : &valueData[0], valueData.size()));
+		stream.WriteRecordBatch(numRecords, nodes, buffers);
+
+		numRecords = 0;
+		recordNumbers.clear();
+		timestamps.clear();
+		for (size_t column = 0; column < ARROW_NUM_COLUMNS; column++)
+			columns[column].clear();
+		fieldOffsets.clear();
+		fieldKeys.clear();
+		valueOffsets.assign(1, 0);
+		valueData.clear();
+	}
+
+	static void	AddColumn(std::vector<int64_t>& nodes, std::vector<ArrowBuffer>& buffers, size_t length, size_t nulls, ArrowBuffer validity, ArrowBuffer values) {
+		nodes.push_back(length);
+		nodes.push_back(nulls);
+		buffers.push_back(validity);
+		buffers.push_back(values);
+	}
+
+	ArrowStreamWriter	stream;
+	ArrowDictionary		dictionaries[ARROW_NUM_COLUMNS + 1];	/*  the last one is of the Key values */
+	size_t			numRecords;
+	std::vector<uint64_t>	recordNumbers;
+	std::vector<int64_t>	timestamps;
+	std::vector<int32_t>	columns[ARROW_NUM_COLUMNS];	/*  dictionary indices, -1 if the record has no such value */
+	std::vector<int32_t>	fieldOffsets;	/*  where the Fields of every record start */
+	std::vector<int32_t>	fieldKeys;
+	std::vector<int32_t>	valueOffsets;
+	std::vector<char>	valueData;
+	std::vector<char>	keyScratch;
+	std::vector<char>	valueScratch;
+};
+
+/*  Chunks [firstChunk, endChunk) are handed out to the workers in file order and printed in the same order.
+ *  The index is filled in with --build-index, otherwise chunks it rules out are not read at all */
+class ChunkScheduler {
+public:
+	ChunkScheduler(InputFile& file, const ParseOptions& parseOptions, std::vector<EvtxIndexEntry>* chunkIndex, FollowState* followState, FILE* output, uint64_t firstChunk = 0, uint64_t endChunk = UINT64_MAX) :
+		input(file), options(parseOptions), index(chunkIndex), follow(followState), carved(NULL), out(output), nextChunk(firstChunk), nextToPrint(firstChunk), stopAt(endChunk - 1), result(true) {
+		CreateArrowWriter();
+	}
+
+	/*  --carve: the chunks found, at any offset; a chunk that fails does not stop the others */
+	ChunkScheduler(InputFile& file, const ParseOptions& parseOptions, const std::vector<CarvedChunk>& carvedChunks, FILE* output) :
+		input(file), options(parseOptions), index(NULL), follow(NULL), carved(&carvedChunks), out(output), nextChunk(0), nextToPrint(0), stopAt(carvedChunks.size() - 1), result(true) {
+		CreateArrowWriter();
+	}
+
+	void	RunWorker() {
+		WorkerContext		worker(options.format, &options.filter);
+		std::vector<uint8_t>	buffer;
+
+		worker.indexing = options.buildIndex;
+		worker.timing = ( options.stats != NULL );
+		worker.templateCache = options.templateCache;
+		worker.fields = &options.fields;
+		worker.verifying = options.verify;
+		worker.merging = ( options.merger != NULL );
+		worker.recordTime.SetPrecision(options.timePrecision);
+		worker.valueTime.SetPrecision(options.timePrecision);
+		if ( options.visitor != NULL )
+			worker.SetVisitor(options.visitor);
+		else if ( options.summary != NULL )
+			worker.SetSummary(options.summary->Keys());
+
+		while ( 1 )
+		{
+			uint64_t	chunkIdx	=	nextChunk++;
+			uint64_t	off;
+			const uint8_t*	chunk		=	NULL;
+			ChunkResult	chunkResult	=	ChunkParsed;
+			ReadResult	readResult;
+
+			if ( chunkIdx > stopAt )
+				break;
+			if ( carved != NULL )
+			{
+				/*  the scan checked the checksums already, with --verify a dirty chunk is skipped rather than salvaged */
+				off = (*carved)[chunkIdx].offset;
+				worker.salvaging = !(*carved)[chunkIdx].intact && !options.verify;
+				worker.verifying = !(*carved)[chunkIdx].intact && options.verify;
+				STATS_ADD(&worker, chunksCarved, 1);
+				STATS_ADD(&worker, chunksDirty, (*carved)[chunkIdx].intact ? 0 : 1);
+			}
+			else
+			{
+				off = sizeof(EvtxHeader) + chunkIdx * EVTX_CHUNK_SIZE;
+			}
+
+			if ( !options.buildIndex && index != NULL && chunkIdx < index->size() && !options.filter.MatchesIndexEntry((*index)[chunkIdx]) )
+			{
+				STATS_ADD(&worker, chunksSkipped, 1);
+				input.Skip(off, EVTX_CHUNK_SIZE);
+				goto skipped;
+			}
+
+			{
+				STATS_TIMER(&worker, readStart);
+				readResult = input.Read(off, EVTX_CHUNK_SIZE, &chunk, buffer);
+				STATS_ADD_TIME(&worker, readTime, readStart);
+			}
+
+			switch ( readResult )
+			{
+			case ReadOK:
+				{
+					STATS_TIMER(&worker, parseStart);
+					input.Prefetch(off + EVTX_CHUNK_SIZE, EVTX_CHUNK_SIZE);
+					chunkResult = ParseChunk(&worker, chunk, EVTX_CHUNK_SIZE, off);
+					STATS_ADD_TIME(&worker, parseTime, parseStart);
+				}
+				STATS_ADD(&worker, bytesRead, EVTX_CHUNK_SIZE);
+				STATS_ADD(&worker, chunksParsed, chunkResult == ChunkParsed ? 1 : 0);
+				STATS_ADD(&worker, chunksFailed, chunkResult == ChunkFailed ? 1 : 0);
+				break;
+			case ReadShort:
+				chunkResult = ChunkEndOfFile;
+				break;
+			case ReadError:
+				chunkResult = ChunkFailed;
+				break;
+			}
+
+		skipped:
+			std::unique_lock<std::mutex>	lock(printLock);
+			printed.wait(lock, [&]{ return nextToPrint == chunkIdx || chunkIdx > stopAt; });
+			if ( chunkIdx > stopAt )
+				break;
+			if ( options.buildIndex )
+			{
+				worker.out.Clear();
+				if ( chunkResult == ChunkParsed || chunkResult == ChunkSkipped )
+					index->push_back(worker.indexEntry);
+			}
+			else if ( out == NULL )
+			{
+				worker.out.Clear();
+			}
+			else if ( options.merger != NULL )
+			{
+				options.merger->Add(options.mergeInput, worker.out.Data(0), worker.out.Size(), worker.recordKeys);
+				worker.out.Clear();
+				worker.recordKeys.clear();
+			}
+			else if ( arrow )
+			{
+				STATS_TIMER(&worker, outputStart);
+				arrow->Append(worker.out.Data(0), worker.out.Size());
+				worker.out.Clear();
+				STATS_ADD_TIME(&worker, outputTime, outputStart);
+			}
+			else
+			{
+				STATS_TIMER(&worker, outputStart);
+				STATS_ADD(&worker, bytesWritten, worker.out.Size());
+				worker.out.Flush(out);
+				STATS_ADD_TIME(&worker, outputTime, outputStart);
+			}
+			if ( follow != NULL && worker.lastRecord > follow->lastRecord )
+			{
+				follow->lastRecord = worker.lastRecord;
+				follow->lastChunk = chunkIdx;
+			}
+			if ( chunkResult != ChunkParsed && chunkResult != ChunkSkipped && carved == NULL )
+			{
+				stopAt = chunkIdx;
+				result = ( chunkResult == ChunkEndOfFile );
+			}
+			nextToPrint++;
+			printed.notify_all();
+		}
+		if ( options.stats != NULL )
+			options.stats->Add(worker.stats);
+		if ( worker.summary != NULL )
+			options.summary->Add(worker.summary->Table());
+	}
+
+	bool	Result() const {
+		return result;
+	}
+
+	/*  After the workers are done */
+	void	Finish() {
+		if ( arrow )
+			arrow->Finish();
+	}
+
+private:
+	void	CreateArrowWriter() {
+		if ( options.format == EvtxFormatArrow && out != NULL && options.visitor == NULL && !options.buildIndex && options.merger == NULL )
+			arrow.reset(new ArrowBatchWriter(out));
+	}
+
+	InputFile&		input;
+	const ParseOptions&	options;
+	std::vector<EvtxIndexEntry>*	index;
+	FollowState*		follow;
+	const std::vector<CarvedChunk>*	carved;
+	FILE*			out;
+	std::atomic<uint64_t>	nextChunk;
+	std::mutex		printLock;
+	std::condition_variable	printed;
+	uint64_t		nextToPrint;
+	std::atomic<uint64_t>	stopAt;
+	bool			result;
+	std::unique_ptr<ArrowBatchWriter>	arrow;	/*  --format=arrow */
+};
+
+bool	RunScheduler(ChunkScheduler& scheduler, unsigned numThreads)
+{
+	if ( numThreads <= 1 )
+	{
+		scheduler.RunWorker();
+	}
+	else
+	{
+		std::vector<std::thread>	threads;
+
+		for (unsigned idx = 0; idx < numThreads; idx++)
+			threads.emplace_back(&ChunkScheduler::RunWorker, &scheduler);
+		for (auto& t : threads)
+			t.join();
+	}
+
+	scheduler.Finish();
+	return scheduler.Result();
+}
+
+#define CARVE_WINDOW_SIZE	( 256 * EVTX_CHUNK_SIZE )
+
+/*  Scans the whole input for the chunk magic, a window at a time. The windows overlap by the magic's length,
+ *  and the scan goes on after the end of every chunk taken */
+bool	FindCarvedChunks(InputFile& input, std::vector<CarvedChunk>& chunks)
+{
+	const size_t		magicLen	=	sizeof(EVTX_CHUNK_HEADER_MAGIC);
+	uint64_t		inputSize	=	input.Size();
+	uint64_t		windowStart	=	0;
+	std::vector<uint8_t>	windowBuffer;
+	std::vector<uint8_t>	chunkBuffer;
+
+	while ( windowStart + EVTX_CHUNK_SIZE <= inputSize )
+	{
+		uint64_t	windowLen	=	std::min<uint64_t>(CARVE_WINDOW_SIZE, inputSize - windowStart);
+		uint64_t	pos		=	0;
+		const uint8_t*	window;
+
+		if ( input.Read(windowStart, windowLen, &window, windowBuffer) != ReadOK )
+			return false;
+
+		while ( pos + magicLen <= windowLen )
+		{
+			const uint8_t*	hit	=	(const uint8_t*)memchr(window + pos, EVTX_CHUNK_HEADER_MAGIC[0], windowLen - magicLen + 1 - pos);
+			const uint8_t*	chunk;
+			CarvedChunk	carved;
+
+			if ( hit == NULL )
+				break;
+			pos = hit - window;
+			carved.offset = windowStart + pos;
+			if ( carved.offset + EVTX_CHUNK_SIZE > inputSize )
+				break;
+			if ( memcmp(hit, EVTX_CHUNK_HEADER_MAGIC, magicLen) )
+			{
+				pos++;
+				continue;
+			}
+			if ( pos + EVTX_CHUNK_SIZE <= windowLen )
+				chunk = hit;
+			else if ( input.Read(carved.offset, EVTX_CHUNK_SIZE, &chunk, chunkBuffer) != ReadOK )
+				return false;
+
+			if ( CheckChunkChecksums(chunk, &carved.intact) )
+			{
+				chunks.push_back(carved);
+				pos += EVTX_CHUNK_SIZE;
+			}
+			else
+			{
+				pos++;
+			}
+		}
+		windowStart += std::max<uint64_t>(pos, windowLen - magicLen + 1);
+	}
+	return true;
+}
+
+/*  --carve: the input may be anything holding chunks, a disk image, a pagefile or unallocated clusters.
+ *  Every chunk found is parsed, in parallel and printed in the order they were found */
+bool	CarveEVTX(InputFile& input, const ParseOptions& options, FILE* out)
+{
+	std::vector<CarvedChunk>	chunks;
+
+	if ( !FindCarvedChunks(input, chunks) )
+		return false;
+	if ( chunks.empty() )
+		return true;
+
+	ChunkScheduler	scheduler(input, options, chunks, out);
+
+	return RunScheduler(scheduler, options.numThreads);
+}
+
+/*  Messages about a whole file go where the "Failed on" ones go */
+void	ReportError(const ParseOptions& options, FILE* out, const char* text)
+{
+	if ( options.visitor != NULL )
+		options.visitor->OnError(text);
+	else
+		fputs(text, options.format == EvtxFormatRaw ? out : stderr);
+}
+
+/*  With follow set only the chunks from follow->lastChunk on are parsed, and the ones before it if the file wrapped around since */
+bool	ParseEVTXInt(InputFile& input, const ParseOptions& options, std::vector<EvtxIndexEntry>* index, FollowState* follow, FILE* out) {
+	std::vector<uint8_t>	buffer;
+	const uint8_t*		headerData;
+
+	if ( options.carve && follow == NULL )
+		return CarveEVTX(input, options, out);
+	if ( input.Read(0, sizeof(EvtxHeader), &headerData, buffer) != ReadOK )
+		return false;
+
+	const EvtxHeader&	header	=	*reinterpret_cast<const EvtxHeader*>(headerData);
+
+	if ( header.version != 0x00030001 && header.version != 0x00030002)
+		return false;
+	/*  the chunks are checked one by one anyway */
+	if ( options.verify && follow == NULL && Crc32(0, headerData, offsetof(EvtxHeader, flags)) != header.checksum )
+		ReportError(options, out, "File header fails the checksum\n");
+
+#ifdef PRINT_TAGS
+	printf("Number of chunks: %u, %" PRIu64 " .. %" PRIu64 " header sz %zu\n", header.numberOfChunks, header.firstChunkNumber, header.lastChunkNumber, sizeof(header));
+#endif
+
+	if ( follow == NULL )
+	{
+		ChunkScheduler	scheduler(input, options, index, NULL, out);
+
+		return RunScheduler(scheduler, options.numThreads);
+	}
+
+	uint64_t	startChunk	=	follow->lastChunk;
+	bool		wrapped		=	( startChunk > 0 && header.lastChunkNumber < startChunk );
+	ChunkScheduler	scheduler(input, options, NULL, follow, out, startChunk);
+
+	if ( !RunScheduler(scheduler, options.numThreads) )
+		return false;
+	if ( !wrapped )
+		return true;
+
+	ChunkScheduler	wrapScheduler(input, options, NULL, follow, out, 0, startChunk);
+
+	return RunScheduler(wrapScheduler, options.numThreads);
+}
+
+/*  The index has to be younger than the file and of the same size */
+void	GetIndexStamp(int f, bool verify, EvtxIndexHeader* header)
+{
+	struct stat	st;
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, EVTX_INDEX_MAGIC, sizeof(EVTX_INDEX_MAGIC));
+	header->version = EVTX_INDEX_VERSION;
+	header->flags = verify ? EVTX_INDEX_BUILT_VERIFIED : 0;
+	if ( fstat(f, &st) == 0 )
+	{
+		header->fileSize = st.st_size;
+		header->fileTime = st.st_mtime;
+	}
+}
+
+/*  An index built with --verify leaves out chunks a run without it has to print */
+bool	LoadIndex(const std::string& indexName, int f, bool verify, std::vector<EvtxIndexEntry>& index)
+{
+	EvtxIndexHeader	expected;
+	EvtxIndexHeader	header;
+	FILE*		indexFile	=	fopen(indexName.c_str(), "rb");
+	bool		result		=	false;
+
+	if ( indexFile == NULL )
+		return false;
+
+	GetIndexStamp(f, verify, &expected);
+	if ( fread(&header, sizeof(header), 1, indexFile) == 1 &&
+			!memcmp(header.magic, expected.magic, sizeof(header.magic)) &&
+			header.version == expected.version &&
+			header.fileSize == expected.fileSize &&
+			header.fileTime == expected.fileTime &&
+			( verify || !( header.flags & EVTX_INDEX_BUILT_VERIFIED ) ) )
+	{
+		index.resize(header.numChunks);
+		result = ( header.numChunks == 0 || fread(&index[0], sizeof(index[0]), index.size(), indexFile) == index.size() );
+	}
+
+	fclose(indexFile);
+	if ( !result )
+		index.clear();
+	return result;
+}
+
+bool	WriteIndex(const std::string& indexName, int f, bool verify, const std::vector<EvtxIndexEntry>& index)
+{
+	EvtxIndexHeader	header;
+	FILE*		indexFile	=	fopen(indexName.c_str(), "wb");
+	bool		result;
+
+	if ( indexFile == NULL )
+		return false;
+
+	GetIndexStamp(f, verify, &header);
+	header.numChunks = index.size();
+	result = fwrite(&header, sizeof(header), 1, indexFile) == 1 &&
+		( index.empty() || fwrite(&index[0], sizeof(index[0]), index.size(), indexFile) == index.size() );
+
+	if ( fclose(indexFile) != 0 )
+		result = false;
+	return result;
+}
+
+bool	ParseEVTX(const char* fileName, const ParseOptions& options, FILE* out) {
+	bool				result;
+	std::string			indexName	=	std::string(fileName) + EVTX_INDEX_SUFFIX;
+	std::vector<EvtxIndexEntry>	index;
+	bool				haveIndex	=	false;
+	int	f;
+
+	if ( options.buildIndex && options.filter.IsActive() )
+	{
+		/*  the entries describe the whole chunks, not what this run would print of them */
+		ParseOptions	indexOptions	=	options;
+
+		indexOptions.filter = RecordFilter();
+		return ParseEVTX(fileName, indexOptions, out);
+	}
+
+	f = open(fileName, O_RDONLY|O_BINARY);
+	if ( f < 0 )
+		return false;
+
+	CompressionFormat	compression	=	DetectCompression(f);
+	Decompressor*		decompressor	=	CreateDecompressor(f, compression);
+
+	if ( compression != CompressionNone && ( decompressor == NULL || options.carve ) )
+	{
+		ReportError(options, out, ( std::string(fileName) + ( options.carve ? " is compressed, it can't be carved\n" : " is compressed in a format this build can't read\n" ) ).c_str());
+		delete decompressor;
+		close(f);
+		return false;
+	}
+	if ( !options.buildIndex && !options.carve && options.filter.IsActive() )
+		haveIndex = LoadIndex(indexName, f, options.verify, index);
+
+	{
+		InputFile	input(f);
+
+		if ( decompressor != NULL )
+			input.ReadAhead(decompressor, 2 * options.numThreads + 2);
+		else if ( ( !options.useMmap || !input.Map() ) && options.readAhead != 0 && !options.carve && !haveIndex )
+			input.ReadAhead(CreateFileSource(f, options.readAhead), std::max<size_t>(options.readAhead, 2 * options.numThreads + 2));
+		result = ParseEVTXInt(input, options, ( options.buildIndex || haveIndex ) ? &index : NULL, NULL, out);
+	}	/*  the reading thread is done with f */
+	if ( !result )
+		ReportError(options, out, ( "Failed on " + std::string(fileName) + "\n" ).c_str());
+	if ( options.buildIndex && !WriteIndex(indexName, f, options.verify, index) )
+		fprintf(stderr, "Failed to write %s\n", indexName.c_str());
+	close(f);
+	return result;
+}
+
+#define FOLLOW_POLL_INTERVAL_MS	1000
+
+/*  Wakes up when the file changes, or after the timeout where there is no way to be notified */
+class FileWatcher {
+public:
+	FileWatcher(const char* fileName) {
+#if defined(__linux__)
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if ( fd >= 0 && inotify_add_watch(fd, fileName, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0 )
+		{
+			close(fd);
+			fd = -1;
+		}
+#elif defined(_WIN32)
+		std::string	dirName(fileName);
+		size_t		slash	=	dirName.find_last_of("\\/");
+
+		dirName = ( slash == std::string::npos ) ? "." : dirName.substr(0, slash + 1);
+		handle = FindFirstChangeNotificationA(dirName.c_str(), FALSE, FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+#endif
+	}
+
+	~FileWatcher() {
+#if defined(__linux__)
+		if ( fd >= 0 )
+			close(fd);
+#elif defined(_WIN32)
+		if ( handle != INVALID_HANDLE_VALUE )
+			FindCloseChangeNotification(handle);
+#endif
+	}
+
+	void	Wait(unsigned timeoutMs) {
+#if defined(__linux__)
+		if ( fd >= 0 )
+		{
+			struct pollfd	pfd;
+			char		events[4096];
+
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			if ( poll(&pfd, 1, timeoutMs) > 0 )
+				while ( read(fd, events, sizeof(events)) > 0 )
+					;
+			return;
+		}
+#elif defined(_WIN32)
+		if ( handle != INVALID_HANDLE_VALUE )
+		{
+			if ( WaitForSingleObject(handle, timeoutMs) == WAIT_OBJECT_0 )
+				FindNextChangeNotification(handle);
+			return;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+	}
+
+private:
+#if defined(__linux__)
+	int	fd;
+#elif defined(_WIN32)
+	HANDLE	handle;
+#endif
+};
+
+bool	LoadCheckpoint(const std::string& name, FollowState* state)
+{
+	FILE*	f	=	fopen(name.c_str(), "r");
+	bool	result;
+
+	if ( f == NULL )
+		return false;
+	result = ( fscanf(f, "%" SCNu64 " %" SCNu64, &state->lastRecord, &state->lastChunk) == 2 );
+	fclose(f);
+	return result;
+}
+
+/*  Written aside and renamed, so a crash never leaves a broken checkpoint */
+bool	SaveCheckpoint(const std::string& name, const FollowState& state)
+{
+	std::string	tempName	=	name + ".tmp";
+	FILE*		f		=	fopen(tempName.c_str(), "w");
+	bool		result;
+
+	if ( f == NULL )
+		return false;
+	result = ( fprintf(f, "%" PRIu64 " %" PRIu64 "\n", state.lastRecord, state.lastChunk) > 0 );
+	if ( fclose(f) != 0 )
+		result = false;
+#ifdef _WIN32
+	if ( result )
+		remove(name.c_str());
+#endif
+	return result && rename(tempName.c_str(), name.c_str()) == 0;
+}
+
+/*  Prints the records newer than the checkpoint, then waits for the file to grow and prints the new ones, forever */
+void	FollowEVTX(const char* fileName, const ParseOptions& options, const std::string& checkpointName, FILE* out)
+{
+	FollowState	state;
+	FileWatcher	watcher(fileName);
+
+	if ( !checkpointName.empty() )
+		LoadCheckpoint(checkpointName, &state);
+
+	while ( 1 )
+	{
+		ParseOptions	passOptions	=	options;
+		FollowState	before		=	state;
+		int		f		=	open(fileName, O_RDONLY|O_BINARY);
+
+		passOptions.filter.firstRecord = std::max(options.filter.firstRecord, state.lastRecord + 1);
+		if ( f >= 0 )
+		{
+			InputFile	input(f);
+
+			if ( passOptions.useMmap )
+				input.Map();
+			/*  a failure is most likely a record that is being written, the next poll retries it */
+			ParseEVTXInt(input, passOptions, NULL, &state, out);
+			close(f);
+		}
+		fflush(out);
+
+		if ( !checkpointName.empty() && ( state.lastRecord != before.lastRecord || state.lastChunk != before.lastChunk ) &&
+				!SaveCheckpoint(checkpointName, state) )
+			fprintf(stderr, "Failed to write %s\n", checkpointName.c_str());
+
+		watcher.Wait(FOLLOW_POLL_INTERVAL_MS);
+	}
+}
+
+
+}
+
+/*  bench_parse_evtx.cpp includes this file for the internals and leaves out the API */
+#ifndef EVTX_PARSER_NO_API
+
+/*  The one thing the library hands out, see evtx_parser.h */
+struct EvtxParser {
+	ParseOptions	options;
+	TemplateCache	templateCache;
+	StatsCollector	stats;
+	SummaryCollector	summary;
+};
+
+EvtxParser*	EvtxCreateParser(const EvtxOptions& options)
+{
+	EvtxParser*	parser	=	new EvtxParser;
+	ParseOptions&	parse	=	parser->options;
+
+	parse.numThreads = std::max(options.numThreads, 1U);
+	parse.useMmap = options.useMmap;
+	parse.readAhead = std::min(options.readAhead, (unsigned)READ_AHEAD_MAX_CHUNKS);
+	parse.format = options.format;
+	parse.timePrecision = options.timePrecision;
+	parse.buildIndex = options.buildIndex;
+	parse.carve = options.carve;
+	parse.verify = options.verify;
+	parse.filter.firstRecord = options.firstRecord;
+	parse.filter.lastRecord = options.lastRecord;
+	parse.filter.since = options.since;
+	parse.filter.until = options.until;
+	for (auto eventID : options.eventIDs)
+		parse.filter.AddEventID(eventID);
+	for (auto& field : options.fields)
+		parse.fields.AddField(field.c_str(), field.size());
+	if ( !options.summaryKeys.empty() )
+	{
+		/*  only the summary keys are decoded, an Hour or Day not found in the templates does no harm */
+		parse.format = EvtxFormatRaw;
+		parse.fields = FieldProjection();
+		for (auto& key : options.summaryKeys)
+			parse.fields.AddField(key.c_str(), key.size());
+		parser->summary.SetKeys(options.summaryKeys);
+		parse.summary = &parser->summary;
+	}
+	parse.templateCache = &parser->templateCache;
+	parse.stats = options.collectStats ? &parser->stats : NULL;
+	parse.mergeOrder = options.mergeOrder;
+	parse.mergeWindow = options.mergeWindow;
+	return parser;
+}
+
+void	EvtxDestroyParser(EvtxParser* parser)
+{
+	delete parser;
+}
+
+bool	EvtxParseFile(EvtxParser* parser, const char* fileName, FILE* out)
+{
+	return ParseEVTX(fileName, parser->options, out);
+}
+
+bool	EvtxParseBuffer(EvtxParser* parser, const uint8_t* data, uint64_t size, FILE* out)
+{
+	InputFile	input(data, size);
+
+	return ParseEVTXInt(input, parser->options, NULL, NULL, out);
+}
+
+/*  One worker, so the visitor sees the records in order and never from two threads */
+bool	EvtxVisitFile(EvtxParser* parser, const char* fileName, EvtxVisitor* visitor)
+{
+	ParseOptions	options	=	parser->options;
+
+	options.numThreads = 1;
+	options.buildIndex = false;
+	options.visitor = visitor;
+	return ParseEVTX(fileName, options, NULL);
+}
+
+bool	EvtxVisitBuffer(EvtxParser* parser, const uint8_t* data, uint64_t size, EvtxVisitor* visitor)
+{
+	ParseOptions	options	=	parser->options;
+	InputFile	input(data, size);
+
+	options.numThreads = 1;
+	options.visitor = visitor;
+	return ParseEVTXInt(input, options, NULL, NULL, NULL);
+}
+
+bool	EvtxMergeFiles(EvtxParser* parser, const std::vector<std::string>& fileNames, unsigned numFilesAtOnce, FILE* out)
+{
+	RecordMerger			merger(parser->options.mergeOrder, parser->options.mergeWindow);
+	std::atomic<size_t>		nextFile(0);
+	std::atomic<bool>		result(true);
+	std::vector<std::thread>	threads;
+	auto				parseFiles	=	[&]() {
+		size_t		fileIdx;
+
+		while ( ( fileIdx = nextFile++ ) < fileNames.size() )
+		{
+			ParseOptions	options	=	parser->options;
+
+			options.buildIndex = false;
+			options.merger = &merger;
+			options.mergeInput = fileIdx;
+			if ( !ParseEVTX(fileNames[fileIdx].c_str(), options, out) )
+				result = false;
+		}
+	};
+
+	if ( parser->options.format == EvtxFormatArrow )
+		return false;
+	for (unsigned idx = 1; idx < numFilesAtOnce && idx < fileNames.size(); idx++)
+		threads.emplace_back(parseFiles);
+	parseFiles();
+	for (auto& t : threads)
+		t.join();
+	if ( !merger.Finish(out) )
+	{
+		fprintf(stderr, "Failed to read back the temporary files of the merge\n");
+		result = false;
+	}
+	return result;
+}
+
+void	EvtxFollowFile(EvtxParser* parser, const char* fileName, const char* checkpointName, FILE* out)
+{
+	FollowEVTX(fileName, parser->options, checkpointName != NULL ? checkpointName : "", out);
+}
+
+void	EvtxPrintStats(EvtxParser* parser, FILE* out)
+{
+	if ( parser->options.stats != NULL )
+		parser->options.stats->Print(out);
+}
+
+void	EvtxPrintSummary(EvtxParser* parser, FILE* out)
+{
+	if ( parser->options.summary != NULL )
+		parser->options.summary->Print(out);
+}
+
+#endif
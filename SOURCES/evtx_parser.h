@@ -0,0 +1,149 @@
+/*
+ * =====================================================================================
+ *       Filename:  evtx_parser.h
+ *    Description:  EVTX parsing library, parse_evtx is built on top of it
+ * =====================================================================================
+ */
+
+#ifndef evtx_parser_h_included
+#define evtx_parser_h_included
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*  Define EVTX_PARSER_DLL when building or using evtx_parser as a DLL, and EVTX_PARSER_BUILD when building it */
+#if defined(_WIN32) && defined(EVTX_PARSER_DLL)
+#if defined(EVTX_PARSER_BUILD)
+#define EVTX_API	__declspec(dllexport)
+#else
+#define EVTX_API	__declspec(dllimport)
+#endif
+#else
+#define EVTX_API
+#endif
+
+typedef enum
+{
+	EvtxFormatRaw		=	1,	/*  the historical 'key':'value', lines */
+	EvtxFormatJsonLines	=	2,
+	EvtxFormatCsv		=	3,
+	EvtxFormatArrow		=	4,	/*  an Apache Arrow IPC stream per file, not with EvtxFollowFile() */
+	EvtxFormatXml		=	5,	/*  the XML of every record as rendered by wevtutil, one <Event> per line */
+}
+EvtxFormat;
+
+/*  Digits after the seconds of the printed timestamps */
+typedef enum
+{
+	EvtxTimeSeconds		=	0,
+	EvtxTimeMicroseconds	=	6,
+	EvtxTime100ns		=	7,	/*  all a FILETIME has */
+}
+EvtxTimePrecision;
+
+/*  The order of EvtxMergeFiles() */
+typedef enum
+{
+	EvtxOrderTime		=	1,	/*  the timestamps of the record headers */
+	EvtxOrderRecordNumber	=	2,
+}
+EvtxMergeOrder;
+
+/*  BinXml value types, as passed to EvtxVisitor::OnField() */
+#define EVTX_TYPE_NULL		0x00
+#define EVTX_TYPE_STRING	0x01	/*  UTF-16LE, not terminated */
+#define EVTX_TYPE_ANSI_STRING	0x02
+#define EVTX_TYPE_UINT8		0x04
+#define EVTX_TYPE_UINT16	0x06
+#define EVTX_TYPE_UINT32	0x08
+#define EVTX_TYPE_UINT64	0x0A
+#define EVTX_TYPE_BINARY	0x0E
+#define EVTX_TYPE_GUID		0x0F
+#define EVTX_TYPE_FILETIME	0x11
+#define EVTX_TYPE_SID		0x13
+#define EVTX_TYPE_HEX32		0x14
+#define EVTX_TYPE_HEX64		0x15
+#define EVTX_TYPE_STRING_ARRAY	0x81	/*  NUL separated UTF-16LE strings */
+#define EVTX_TYPE_TEXT		0x100	/*  a value written in the template itself, already UTF-8 */
+
+struct EvtxOptions {
+	EvtxOptions() : numThreads(1), useMmap(true), readAhead(16), format(EvtxFormatRaw), timePrecision(EvtxTimeSeconds), firstRecord(0), lastRecord(UINT64_MAX),
+		since(0), until(UINT64_MAX), buildIndex(false), carve(false), verify(false), collectStats(false), mergeOrder(EvtxOrderTime), mergeWindow(256 << 20) {}
+
+	unsigned			numThreads;	/*  chunks of one file parsed at once, the text output keeps the file order */
+	bool				useMmap;	/*  map the files instead of reading them */
+	unsigned			readAhead;	/*  chunks of a file that is not mapped read ahead of the parsing, on a thread of
+							 *  their own (io_uring on Linux); 0 reads each chunk when it is parsed */
+	EvtxFormat			format;		/*  of EvtxParseFile() and EvtxParseBuffer() */
+	EvtxTimePrecision		timePrecision;
+
+	/*  Only the matching records are printed or visited */
+	uint64_t			firstRecord;	/*  inclusive */
+	uint64_t			lastRecord;
+	uint64_t			since;		/*  FILETIME, inclusive */
+	uint64_t			until;
+	std::vector<uint16_t>		eventIDs;	/*  empty if any will do */
+	std::vector<std::string>	fields;		/*  keys to print, empty for all of them */
+	std::vector<std::string>	summaryKeys;	/*  if any, EvtxParseFile() and EvtxParseBuffer() count the records by the values
+							 *  of these keys for EvtxPrintSummary() instead of printing them, the format and
+							 *  fields do not matter; Hour and Day are those of the record timestamp */
+
+	bool				buildIndex;	/*  EvtxParseFile() writes <file>.idx instead of printing */
+	bool				carve;		/*  the input is a disk image or the like, every chunk with a valid header checksum
+							 *  found anywhere in it is parsed; not with buildIndex or EvtxFollowFile() */
+	bool				verify;		/*  skip the chunks whose header or records checksum does not match */
+	bool				collectStats;	/*  for EvtxPrintStats() */
+
+	EvtxMergeOrder			mergeOrder;
+	uint64_t			mergeWindow;	/*  bytes of output EvtxMergeFiles() holds in memory, more is sorted and spilled
+							 *  to temporary files that are merged at the end */
+};
+
+/*  Receives the records of EvtxVisitFile() and EvtxVisitBuffer() in file order, on the calling thread */
+class EvtxVisitor {
+public:
+	virtual ~EvtxVisitor() {}
+
+	/*  timestamp is the FILETIME of the record header */
+	virtual void	OnRecord(uint64_t number, uint64_t timestamp) = 0;
+	/*  type is one of EVTX_TYPE_*, data points into the file and is only valid during the call */
+	virtual void	OnField(const char* key, size_t keyLen, uint16_t type, const uint8_t* data, size_t len) = 0;
+	/*  complete is false if the rest of the record could not be parsed */
+	virtual void	OnRecordEnd(bool complete) {
+		(void)complete;
+	}
+	virtual void	OnError(const char* message) {
+		(void)message;
+	}
+};
+
+/*  Holds the options, the template cache and the statistics. The functions below may be called for
+ *  different files from several threads at once, and any number of parsers can be used independently */
+typedef struct EvtxParser	EvtxParser;
+
+EVTX_API EvtxParser*	EvtxCreateParser(const EvtxOptions& options);
+EVTX_API void		EvtxDestroyParser(EvtxParser* parser);
+
+/*  Text output in the format of the options */
+EVTX_API bool		EvtxParseFile(EvtxParser* parser, const char* fileName, FILE* out);
+EVTX_API bool		EvtxParseBuffer(EvtxParser* parser, const uint8_t* data, uint64_t size, FILE* out);
+
+EVTX_API bool		EvtxVisitFile(EvtxParser* parser, const char* fileName, EvtxVisitor* visitor);
+EVTX_API bool		EvtxVisitBuffer(EvtxParser* parser, const uint8_t* data, uint64_t size, EvtxVisitor* visitor);
+
+/*  The records of all the files as one output, in the mergeOrder of the options (files first to last where two are equal).
+ *  numFilesAtOnce files are parsed at a time; not with EvtxFormatArrow or buildIndex */
+EVTX_API bool		EvtxMergeFiles(EvtxParser* parser, const std::vector<std::string>& fileNames, unsigned numFilesAtOnce, FILE* out);
+
+/*  Prints the records after the checkpoint, then the ones added to the file as it grows, and never returns.
+ *  checkpointName may be NULL, otherwise the position is kept there between runs */
+EVTX_API void		EvtxFollowFile(EvtxParser* parser, const char* fileName, const char* checkpointName, FILE* out);
+
+EVTX_API void		EvtxPrintStats(EvtxParser* parser, FILE* out);
+/*  The number of records of every combination of summaryKeys values seen so far, largest first */
+EVTX_API void		EvtxPrintSummary(EvtxParser* parser, FILE* out);
+
+#endif
@@ -10,1151 +10,614 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
-#include <fcntl.h>
 #include <stdint.h>
-#include <inttypes.h>
 #include <string.h>
 #include <time.h>
 #include "win_types.h"
+#include <sys/stat.h>
+#ifndef S_ISDIR
+#define S_ISDIR(m)	( ( (m) & S_IFMT ) == S_IFDIR )
+#endif
+#ifndef _WIN32
+#include <dirent.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#endif
 #include <unordered_map>
 #include <vector>
-#include <map>
 #include <string>
-#include "eventlist.h"
-
-// #define PRINT_TAGS
-
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include "evtx_parser.h"
 #include "wintime.h"
 
 namespace {
 
-#pragma pack(push, 1)
-
-#define EVTX_HEADER_MAGIC	"ElfFile"
+struct BatchFile {
+	std::string	name;
+	std::string	outputName;
+	uint64_t	size;
+};
 
-typedef struct
-{
-	char		magic[8];
-	uint64_t	numberOfChunksAllocated;
-	uint64_t	numberOfChunksUsed;
-	uint64_t	checksum;
-	uint32_t	flags;
-	uint32_t	version;
-	uint64_t	fileSize;
-	uint8_t		reserved[0x1000 - 0x30];
-}
-EvtxHeader;
+struct FollowOptions {
+	FollowOptions() : enabled(false) {}
+	bool		enabled;
+	std::string	checkpointName;	/*  empty if the position is not kept between runs */
+};
 
-#define EVTX_CHUNK_HEADER_MAGIC	"ElfChnk"
+struct BatchOptions {
+	BatchOptions() : numFiles(1) {}
+	unsigned	numFiles;
+	std::string	outputDir;
+};
 
-typedef struct
+bool	HasEvtxExtension(const char* name)
 {
-	char		magic[8];
-	uint64_t	firstRecordNumber;
-	uint64_t	lastRecordNumber;
-	uint64_t	firstRecordNumber2;
-	uint64_t	lastRecordNumber2;
-	uint32_t	chunkHeaderSize;
-	uint8_t		reserved[0x80 - 0x2C];
-	uint8_t		reserved2[0x200 - 0x80];
-}
-EvtxChunkHeader;
-
-#define EVTX_CHUNK_SIZE		0x10000
+	size_t	len	=	strlen(name);
 
-typedef struct
-{
-	uint32_t	magic;
-	uint32_t	size;
-	uint64_t	number;
-	uint64_t	timestamp;
+	return ( len > 5 ) && !strncasecmp(name + len - 5, ".evtx", 5);
 }
-EvtxRecordHeader;
 
-
-typedef struct
+void	AddBatchFile(std::vector<BatchFile>& files, const std::string& name)
 {
-	uint32_t	d1;
-	uint16_t	w1;
-	uint16_t	w2;
-	uint8_t		b1[8];
+	BatchFile	file;
+	struct stat	st;
+
+	file.name = name;
+	file.size = ( stat(name.c_str(), &st) == 0 ) ? st.st_size : 0;
+	files.push_back(file);
 }
-EvtxGUID;
-#pragma pack(pop)
 
-typedef enum
+void	AddDirectory(std::vector<BatchFile>& files, const std::string& dirName)
 {
-	StateNormal		=	1,
-	StateInAttribute	=	2,
-}
-XmlParseState;
-
-struct TemplateDescription;
-
-struct ParseContext {
-	ParseContext*	chunkContext;
-	const uint8_t*	data;
-	uint64_t    dataLen;
-	uint64_t    offset;
-	uint64_t    offsetFromChunkStart;
-	XmlParseState	state;
-	TemplateDescription* currentTemplatePtr;
-	char		cachedValue[256];
-
-	bool	HaveEnoughData(uint64_t numBytes) const {
-		return ( offset + numBytes <= dataLen );
-	}
+	std::vector<std::string>	names;
 
-	void	SkipBytes(uint64_t numBytes) {
-		offset += numBytes;
-	}
+#ifdef _WIN32
+	WIN32_FIND_DATAA	findData;
+	HANDLE			h	=	FindFirstFileA(( dirName + "\\*" ).c_str(), &findData);
 
-	template<class c>
-	bool	ReadData(c* result, uint64_t count = 1)
+	if ( h == INVALID_HANDLE_VALUE )
+		return;
+	do {
+		if ( !( findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) && HasEvtxExtension(findData.cFileName) )
+			names.push_back(dirName + "\\" + findData.cFileName);
+	} while ( FindNextFileA(h, &findData) );
+	FindClose(h);
+#else
+	DIR*		dir	=	opendir(dirName.c_str());
+	struct dirent*	entry;
+
+	if ( dir == NULL )
+		return;
+	while ( ( entry = readdir(dir) ) != NULL )
 	{
-		if ( !HaveEnoughData(sizeof(*result) * count) )
-			return false;
-		for (uint64_t idx = 0; idx < count; idx++)
-		{
-			result[idx] = *(c*)(data + offset);
-			offset += sizeof(*result);
-		}
-		return true;
+		if ( HasEvtxExtension(entry->d_name) )
+			names.push_back(dirName + "/" + entry->d_name);
 	}
-
-	void InheritWithOffset(ParseContext* other, uint64_t wantedLen) {
-		data = other->data + other->offset;
-		dataLen = wantedLen;
-		if ( other->offset + dataLen > other->dataLen ) {
-			/*  invalid len specified, fix it */
-			if ( other->offset >= other->dataLen ) {
-				dataLen = 0; /* out of all bounds */
-			} else {
-				dataLen = other->dataLen - other->offset;
-#if defined(PRINT_TAGS)
-				printf("cap on wantedLen %08zX (%08zX), want %08zX, give %08zX\n", other->offset, other->offset, wantedLen, dataLen);
+	closedir(dir);
 #endif
-			}
-		}
-		offset = 0;
-		chunkContext = other;
-		offsetFromChunkStart = other->offset + other->offsetFromChunkStart;
-		cachedValue[0] = 0;
-	}
 
-	void UpdateLen(uint64_t wantedLen){
-		if ( wantedLen <= dataLen ) {
-			dataLen = wantedLen;
-		}
-	}
-};
+	std::sort(names.begin(), names.end());
+	for (auto& name : names)
+		AddBatchFile(files, name);
+}
 
-bool	ParseBinXml(ParseContext* ctx, uint64_t chunkOffsetInFile);
+/*  Reads one file name per line, "-" stands for stdin */
+void	AddListFile(std::vector<BatchFile>& files, const char* listName)
+{
+	FILE*	list	=	strcmp(listName, "-") ? fopen(listName, "r") : stdin;
+	char	line[4096];
 
-struct TemplateArgPair {
-	TemplateArgPair(const TemplateArgPair&) = delete;
-	TemplateArgPair(TemplateArgPair&& other) {
-		key = other.key;
-		type = other.type;
-		other.key = nullptr;
-	}
-	TemplateArgPair(const char* ekey, uint16_t etype){
-		key = strdup(ekey);
-		type = etype;
-	}
-	~TemplateArgPair() {
-		if ( key ) {
-			free(key);
-		}
+	if ( list == NULL )
+	{
+		fprintf(stderr, "Can't open the file list %s\n", listName);
+		return;
 	}
-	char*			key;
-	uint16_t		type;
-};
+	while ( fgets(line, sizeof(line), list) != NULL )
+	{
+		size_t	len	=	strlen(line);
 
-struct TemplateFixedPair {
-	TemplateFixedPair(const TemplateFixedPair&) = delete;
-	TemplateFixedPair(TemplateFixedPair&& other){
-		key = other.key;
-		value = other.value;
-		other.key = nullptr;
-		other.value = nullptr;
-	}
-	TemplateFixedPair(const char* ekey, const char* evalue) {
-		key = strdup(ekey);
-		value = strdup(evalue);
-	}
-	~TemplateFixedPair() {
-		if ( key ) {
-			free(key);
-		}
-		if ( value ) {
-			free(value);
-		}
+		while ( len > 0 && ( line[len - 1] == '\n' || line[len - 1] == '\r' ) )
+			line[--len] = 0;
+		if ( len != 0 )
+			AddBatchFile(files, line);
 	}
-	char*			key;
-	char*			value;
-};
-
-struct TemplateDescription {
-	TemplateDescription() : shortID(0) {}
-	uint32_t		shortID;
-	std::vector<TemplateFixedPair>		fixed;
-	std::unordered_map<uint16_t, TemplateArgPair>	args;
+	if ( list != stdin )
+		fclose(list);
+}
 
-	void	RegisterFixedPair(const char* key, const char* value) {
-		fixed.emplace_back(TemplateFixedPair(key, value));
-	}
+void	AddInput(std::vector<BatchFile>& files, const char* arg)
+{
+	struct stat	st;
+
+	if ( arg[0] == '@' )
+		AddListFile(files, arg + 1);
+	else if ( stat(arg, &st) == 0 && S_ISDIR(st.st_mode) )
+		AddDirectory(files, arg);
+	else
+		AddBatchFile(files, arg);
+}
 
-	void	RegisterArgPair(const char* key, uint16_t type, uint16_t argIdx) {
-		args.emplace(std::make_pair(argIdx, TemplateArgPair(key ? key : "", type)));
-	}
+/*  Picks a unique <outputDir>/<basename>.txt (.arrows for --format=arrow) for every input */
+void	AssignOutputNames(std::vector<BatchFile>& files, const std::string& outputDir, const char* extension)
+{
+	std::unordered_map<std::string, unsigned>	used;
 
-};
+	for (auto& file : files)
+	{
+		size_t		slash	=	file.name.find_last_of("/\\");
+		std::string	base	=	( slash == std::string::npos ) ? file.name : file.name.substr(slash + 1);
+		unsigned	count	=	used[base]++;
 
-#define countof(arr) ( sizeof(arr) / sizeof(*arr) )
+		if ( count != 0 )
+			base += "_" + std::to_string(count);
+		file.outputName = outputDir + "/" + base + extension;
+	}
+}
 
-#define MAX_NAME_STACK_DEPTH	20
-#define INVALID_STACK_DEPTH 	((ssize_t)-1)
+void	CopyFileData(FILE* from, FILE* to)
+{
+	char	buffer[0x10000];
+	size_t	len;
 
-struct NameStackElement{
-	char	name[256];
-};
+	rewind(from);
+	while ( ( len = fread(buffer, 1, sizeof(buffer), from) ) != 0 )
+		fwrite(buffer, 1, len, to);
+}
 
-// Current time 2 m 20 sec
-constexpr unsigned maxNameStackDepth = 20;
-class NameStack {
+/*  Files are taken largest first. With a shared stdout the worker that owns it writes directly,
+ *  the others spool into a temporary file and append it when the file is done */
+class BatchScheduler {
 public:
-	NameStack() : nameStack(maxNameStackDepth), nameStackPtr(INVALID_STACK_DEPTH) {}
+	BatchScheduler(std::vector<BatchFile>& batchFiles, EvtxParser* evtxParser, const BatchOptions& batchOptions)
+		: files(batchFiles), parser(evtxParser), batch(batchOptions), nextFile(0) {}
 
-	void Reset() {
-		nameStackPtr = INVALID_STACK_DEPTH;
-	}
-
-	void	PushName(const char* name) {
-		if ( nameStackPtr + 1 >= MAX_NAME_STACK_DEPTH )
-			return;
-		nameStackPtr++;
-		strncpy(nameStack[nameStackPtr].name, name, sizeof(nameStack[nameStackPtr].name));
-		nameStack[nameStackPtr].name[ sizeof(nameStack[nameStackPtr].name) - 1 ]  = 0;
-	}
-
-	void	PopName(void) {
-		if ( nameStackPtr > INVALID_STACK_DEPTH )
-			nameStackPtr--;
-	}
+	void	RunWorker() {
+		while ( 1 )
+		{
+			size_t	fileIdx	=	nextFile++;
 
-	const char* GetName() const {
-		if ( nameStackPtr <= INVALID_STACK_DEPTH || nameStackPtr >= MAX_NAME_STACK_DEPTH )
-			return NULL;
-		return nameStack[nameStackPtr].name;
+			if ( fileIdx >= files.size() )
+				break;
+			if ( batch.outputDir.empty() )
+				ParseToStdout(files[fileIdx]);
+			else
+				ParseToFile(files[fileIdx]);
+		}
 	}
 
-	const char* GetUpperName() const {
-		if ( nameStackPtr <= INVALID_STACK_DEPTH || nameStackPtr >= MAX_NAME_STACK_DEPTH )
-			return NULL;
-		if ( nameStackPtr < 1 )
-			return NULL;
+private:
+	void	ParseToFile(const BatchFile& file) {
+		FILE*	out	=	fopen(file.outputName.c_str(), "wb");
 
-		return nameStack[nameStackPtr - 1].name;
+		if ( out == NULL )
+		{
+			fprintf(stderr, "Can't create %s\n", file.outputName.c_str());
+			return;
+		}
+		EvtxParseFile(parser, file.name.c_str(), out);
+		fclose(out);
 	}
 
-private:
-	std::vector<NameStackElement> nameStack;
-	ssize_t		nameStackPtr;
-};
-
-NameStack nameStack;
+	void	ParseToStdout(const BatchFile& file) {
+		FILE*	spool	=	NULL;
 
-class Templates {
-public:
-	// 2 m 29 sec with this map
-	bool	IsKnownID(uint32_t	id, TemplateDescription** result) {
-		auto it = knownIDs.find(id);
-		if ( it == knownIDs.end() ) {
-			return false;
+		if ( stdoutLock.try_lock() )
+		{
+			EvtxParseFile(parser, file.name.c_str(), stdout);
+			stdoutLock.unlock();
+			return;
 		}
-		*result = &it->second;
-		return true;
-	}
 
-	bool	RegisterID(uint32_t	id, TemplateDescription** result) {
-		knownIDs[id] = TemplateDescription{};
-		auto it = knownIDs.find(id);
-		if ( it == knownIDs.end() ) {
-			return false;
+		spool = tmpfile();
+		if ( spool == NULL )
+		{
+			std::lock_guard<std::mutex>	lock(stdoutLock);
+			EvtxParseFile(parser, file.name.c_str(), stdout);
+			return;
 		}
-		*result = &it->second;
-		return true;
-	}
+		EvtxParseFile(parser, file.name.c_str(), spool);
 
-	void Reset() {
-		knownIDs.clear();
+		std::lock_guard<std::mutex>	lock(stdoutLock);
+		CopyFileData(spool, stdout);
+		fclose(spool);
 	}
 
-private:
-	std::unordered_map<uint32_t,TemplateDescription>	knownIDs;
+	std::vector<BatchFile>&	files;
+	EvtxParser*		parser;
+	const BatchOptions&	batch;
+	std::atomic<size_t>	nextFile;
+	std::mutex		stdoutLock;
 };
 
-Templates ids;
-
-std::unordered_map<uint16_t, std::string> eventDescriptionHashTable;
-const char*	logonTypes[]	= { NULL, NULL, "Interactive", "Network", "Batch", "Service", NULL, "Unlock", "NetworkCleartext", "NewCredentials", "RemoteInteractive", "CachedInteractive"};
-
-void	ResetTemplates(void)
-{
-	ids.Reset();
-}
-
-void	SetState(ParseContext* ctx, XmlParseState newState)
+void	ParseBatch(std::vector<BatchFile>& files, EvtxParser* parser, const BatchOptions& batch, EvtxFormat format)
 {
-	if ( newState == ctx->state )
-		return;
-
-	if ( ctx->state == StateInAttribute )
-		nameStack.PopName();
-
-	ctx->state = newState;
-}
-
-void	UTF16ToUTF8(uint16_t w, char* buffer, uint64_t* bufferUsed, uint64_t bufferSize)
-{
-	uint32_t	charLength	=	1;
-	uint8_t		msb		=	0;
-	uint8_t		mask		=	0;
+	if ( !batch.outputDir.empty() )
+		AssignOutputNames(files, batch.outputDir, format == EvtxFormatArrow ? ".arrows" : ( format == EvtxFormatXml ? ".xml" : ".txt" ));
 
-	if ( w > 0x7F )
+	if ( batch.numFiles <= 1 )
 	{
-		charLength++;
-		msb |= 0x80 + 0x40;
-		mask = 0xFF;
-	}
-	if ( w > 0x7FF )
-	{
-		charLength++;
-		msb |= 0x20;
-		mask = 0x1F;
-	}
-	if ( w > 0xFFFF )
-	{
-		charLength++;
-		msb |= 0x10;
-		mask = 0x0F;
-	}
-
-	if ( *bufferUsed + charLength >= bufferSize )
-		return;	/*  no buffer overruns */
+		BatchScheduler	scheduler(files, parser, batch);
 
-	if ( charLength == 1 )
-	{
-		buffer[*bufferUsed] = w;
-		(*bufferUsed)++;
+		scheduler.RunWorker();
 		return;
 	}
 
-	// printf("\n%04X -> ", (uint16_t)w);
-
-	for (uint32_t charIndex = charLength - 1; charIndex > 0; charIndex--)
-	{
-		buffer[*bufferUsed + charIndex] = 0x80 | ( w & 0x3F );
-		// printf(" ... [%X] %02X ", charIndex, buffer[*bufferUsed + charIndex]);
-		w >>= 6;
-	}
-
-	buffer[*bufferUsed] = msb | ( w & mask );
+	std::stable_sort(files.begin(), files.end(), [](const BatchFile& a, const BatchFile& b) { return a.size > b.size; });
 
-#if 0
-	for (uint32_t idx = 0; idx < charLength; idx++)
-		printf("%02X ", (uint8_t)buffer[*bufferUsed + idx]);
-	printf("\n");
-#endif
+	BatchScheduler			scheduler(files, parser, batch);
+	std::vector<std::thread>	threads;
 
-	*bufferUsed += charLength;
+	for (unsigned idx = 0; idx < batch.numFiles && idx < files.size(); idx++)
+		threads.emplace_back(&BatchScheduler::RunWorker, &scheduler);
+	for (auto& t : threads)
+		t.join();
 }
 
-bool	ReadPrefixedUnicodeString(ParseContext* ctx, char* nameBuffer, uint64_t nameBufferSize, bool isNullTerminated)
+/*  YYYY-MM-DD[Thh:mm[:ss]][Z] in UTC, resolution is the length of the last given field in FILETIME units */
+bool	ParseFilterTime(const char* str, uint64_t* fileTime, uint64_t* resolution)
 {
-	uint16_t	nameCharCnt;
-	uint64_t nameBufferUsed	=	0;
-	uint64_t idx		=	0;
+	unsigned	year, month, day, hour = 0, minute = 0, second = 0;
+	int		used	=	0;
+	int64_t		days;
 
-	if ( !ctx->ReadData(&nameCharCnt) )
+	if ( sscanf(str, "%4u-%2u-%2u%n", &year, &month, &day, &used) != 3 )
 		return false;
+	str += used;
+	*resolution = 86400ULL * 10000000;
 
-	// TODO : convert UTF-16 to UTF-8
-	for (idx = 0; idx < nameCharCnt && idx*2 < ( nameBufferSize - 1 ) ; idx ++)
+	if ( *str == 'T' || *str == ' ' || *str == '-' )
 	{
-		uint16_t	w;
-
-		if ( !ctx->ReadData(&w) )
+		if ( sscanf(str + 1, "%2u:%2u%n", &hour, &minute, &used) != 2 )
 			return false;
-		UTF16ToUTF8(w, nameBuffer, &nameBufferUsed, nameBufferSize);
-	}
-
-	if ( nameBufferUsed >= nameBufferSize )
-		nameBufferUsed = nameBufferSize - 1;
-	nameBuffer[nameBufferUsed] = 0;
-
-	ctx->SkipBytes((nameCharCnt - idx + ( isNullTerminated ? 1 : 0 ))*2);
-
-	return true;
-}
-
-bool	ReadName(ParseContext* ctx, char* nameBuffer, uint64_t nameBufferSize)
-{
-	uint16_t	nameHash;
-	uint32_t	chunkOffset;
-	uint32_t	d;
-	ParseContext	temporaryCtx(*ctx->chunkContext);
-	ParseContext*	ctxPtr		=	ctx;
-
-	if ( nameBufferSize < 2 )
-		return false;
-	nameBuffer[0] = 0;
-	if ( !ctx->ReadData(&chunkOffset) )
-		return false;
-	if ( ctx->offset + ctx->offsetFromChunkStart != chunkOffset )
-	{
-		// printf("!!!!!! %08X %08X\n", chunkOffset, (uint32_t)(ctx->offset + ctx->offsetFromChunkStart));
-		ctxPtr = &temporaryCtx;
-		ctxPtr->offset = chunkOffset;
+		str += 1 + used;
+		*resolution = 60ULL * 10000000;
+		if ( *str == ':' )
+		{
+			if ( sscanf(str + 1, "%2u%n", &second, &used) != 1 )
+				return false;
+			str += 1 + used;
+			*resolution = 10000000;
+		}
 	}
-
-	if ( !ctxPtr->ReadData(&d) )
-		return false;
-	if ( !ctxPtr->ReadData(&nameHash) )
-		return false;
-	if ( !ReadPrefixedUnicodeString(ctxPtr, nameBuffer, nameBufferSize, true) )
+	if ( *str == 'Z' )
+		str++;
+	if ( *str != 0 || year < 1601 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60 )
 		return false;
 
+	days = DaysFromCivil(year, month, day);
+	*fileTime = ( ( days + 134774 ) * 86400 + hour * 3600 + minute * 60 + second ) * 10000000ULL;	/*  134774 days from 1601 to 1970 */
 	return true;
 }
 
-const char*	GetProperKeyName(ParseContext* ctx)
+/*  N, N-M, N- or -M */
+bool	ParseRecordRange(const char* str, EvtxOptions& filter)
 {
-	const char*	key;
-	const char*	upperName;
+	char*	end;
 
-	key = nameStack.GetName();
-
-	// printf("Key: %s Upper: %s\n", key, nameStack.GetUpperName());
-
-	upperName = nameStack.GetUpperName();
-
-	if ( ( upperName != NULL ) &&
-		( key != nullptr ) &&
-		!strcmp(key, "Data") &&
-		!strcmp(upperName, "EventData") &&
-		ctx->cachedValue[0] != 0 )
+	if ( *str != '-' )
 	{
-		key = ctx->cachedValue;
-	}
-
-	return key;
-}
-
-bool	ParseValueText(ParseContext* ctx)
-{
-	uint8_t		stringType;
-	char		valueBuffer[256];
-	const char*	upperName;
-	const char*	key;
-
-	if ( !ctx->ReadData(&stringType) )
-		return false;
-	if ( !ReadPrefixedUnicodeString(ctx, valueBuffer, sizeof(valueBuffer), false) )
-		return false;
-	// printf("******* %s=%s", nameStack.GetName(), valueBuffer);
-
-	key = GetProperKeyName(ctx);
-	upperName = nameStack.GetUpperName();
-
-	if ( ( key != NULL ) &&
-		( ( upperName == NULL ) ||
-		strcmp(key, "Name") ||
-		strcmp(upperName, "Data") ) )
-	{
-		if ( ctx->currentTemplatePtr != nullptr ) {
-			ctx->currentTemplatePtr->RegisterFixedPair(key, valueBuffer);
+		filter.firstRecord = strtoull(str, &end, 10);
+		if ( end == str )
+			return false;
+		str = end;
+		if ( *str == 0 )
+		{
+			filter.lastRecord = filter.firstRecord;
+			return true;
 		}
 	}
-
-	SetState(ctx, StateNormal);
-
-	strncpy(ctx->cachedValue, valueBuffer, sizeof(valueBuffer));
-	ctx->cachedValue[sizeof(ctx->cachedValue)-1] = 0;
-
-	return true;
-}
-
-bool	ParseAttributes(ParseContext* ctx)
-{
-	char		nameBuffer[256];
-
-	if ( !ReadName(ctx, nameBuffer, sizeof(nameBuffer)) )
-		return false;
-	// printf(" %s", nameBuffer);
-
-	nameStack.PushName(nameBuffer);
-	SetState(ctx, StateInAttribute);
-
-	return true;
-}
-
-bool	ParseOpenStartElement(ParseContext* ctx, bool hasAttributes)
-{
-	uint8_t		b;
-	uint16_t	w;
-	uint32_t	elementLength;
-	uint32_t	attributeListLength	=	0;
-	char		nameBuffer[256];
-
-	if ( !ctx->ReadData(&w) )
-		return false;
-	if ( !ctx->ReadData(&elementLength) )
-		return false;
-	if ( !ReadName(ctx, nameBuffer, sizeof(nameBuffer)) )
+	if ( *str++ != '-' )
 		return false;
-	if ( hasAttributes )
+	if ( *str != 0 )
 	{
-		if ( !ctx->ReadData(&attributeListLength) )
+		filter.lastRecord = strtoull(str, &end, 10);
+		if ( end == str || *end != 0 )
 			return false;
 	}
-#ifdef PRINT_TAGS
-	printf("<%s [%08X] ", nameBuffer, attributeListLength);
-	fflush(stdout);
-#endif
-
-	nameStack.PushName(nameBuffer);
-
-	return true;
-}
-
-bool	ParseCloseStartElement(ParseContext* ctx)
-{
-	SetState(ctx, StateNormal);
-#ifdef PRINT_TAGS
-	printf(">");
-	fflush(stdout);
-#endif
-	return true;
+	return filter.firstRecord <= filter.lastRecord;
 }
 
-bool	ParseCloseElement(ParseContext* ctx)
+/*  A decimal number and nothing else, up to maxValue; value is left alone otherwise */
+bool	ParseCount(const char* str, uint64_t maxValue, uint64_t* value)
 {
-	SetState(ctx, StateNormal);
-	nameStack.PopName();
+	char*			end;
+	unsigned long long	number;
 
-#ifdef PRINT_TAGS
-	printf("</>");
-	fflush(stdout);
-#endif
+	if ( *str < '0' || *str > '9' )
+		return false;
+	number = strtoull(str, &end, 10);
+	if ( *end != 0 || number > maxValue )	/*  an overflow gives ULLONG_MAX */
+		return false;
+	*value = number;
 	return true;
 }
 
-bool	ParseTemplateInstance(ParseContext* ctx)
+/*  Comma separated list */
+bool	ParseEventIDList(const char* str, std::vector<uint16_t>& eventIDs)
 {
-	uint8_t		b;
-	uint32_t	numArguments;
-	uint32_t	shortID;
-	uint32_t	tempResLen;
-	uint32_t	totalArgLen		=	0;
-
-	if ( !ctx->ReadData(&b) )
-		return false;
-	if ( b != 0x01 )
-		return false;
-	if ( !ctx->ReadData(&shortID) )
-		return false;
-	if ( !ctx->ReadData(&tempResLen) )
-		return false;
-	if ( !ctx->ReadData(&numArguments) )
-		return false;
-
-#if defined(PRINT_TAGS)
-	printf("OK, template %08X, num arguments %X\n", shortID, numArguments);
-#endif
-
-	if ( !ids.IsKnownID(shortID, &ctx->currentTemplatePtr) )
-	//if ( numArguments == 0x00000000 )
+	while ( 1 )
 	{
-		uint8_t		longID[16];
-		uint32_t	templateBodyLen;
-		ParseContext	templateCtx;
+		char*		end;
+		unsigned long	eventID	=	strtoul(str, &end, 10);
 
-		/* template definition follows */
-		if ( !ctx->ReadData(&longID[0], sizeof(longID)) )
+		if ( end == str || eventID > 0xFFFF )
 			return false;
-		if ( !ctx->ReadData(&templateBodyLen) )
+		eventIDs.push_back(eventID);
+		if ( *end == 0 )
+			return true;
+		if ( *end != ',' )
 			return false;
-		// printf("Template body, len %08X\n", templateBodyLen);
-
-		templateCtx.InheritWithOffset(ctx, templateBodyLen);  // this will also fix the body len if it's out of bounds
-
-		if ( !ids.RegisterID(shortID, &templateCtx.currentTemplatePtr) ) {
-			return false; // BAD
-		}
-
-		if ( !ParseBinXml(&templateCtx, 0) )
-			return false;
-
-		ctx->SkipBytes(templateBodyLen);
-
-		if ( !ctx->ReadData(&numArguments) )
-			return false;
-
-		ctx->currentTemplatePtr = templateCtx.currentTemplatePtr;
-	}
-
-	// printf("Number of arguments: %08X\n", numArguments);
-
-	for (auto &f : ctx->currentTemplatePtr->fixed){
-		bool	alreadyPrinted	=	false;
-
-		if ( !strcmp(f.key, "EventID") )
-		{
-			uint16_t	eventID	=	strtoul(f.value, NULL, 10);
-			if ( ( eventID != 0 ) && ( eventDescriptionHashTable.find(eventID) != eventDescriptionHashTable.end() ) )
-			{
-				printf("'%s':%u (%s), ", f.key, eventID, eventDescriptionHashTable[eventID].c_str());
-				alreadyPrinted = true;
-			}
-		}
-
-		if ( !alreadyPrinted )
-			printf("'%s':'%s', ", f.key, f.value);
-	}
-
-	// printf("\n");
-
-	uint64_t argumentMapCount	=	numArguments * 2;
-	std::vector<uint16_t>	argumentMap(argumentMapCount);
-
-	if ( !ctx->ReadData(&argumentMap[0], argumentMapCount) )
-	{
-		printf("Failed to read the arguments\n");
-		return false;
+		str = end + 1;
 	}
-
-	for (uint64_t argumentIdx = 0; argumentIdx < numArguments; argumentIdx++)
-	{
-		uint16_t		argLen		=	argumentMap[argumentIdx*2];
-		uint16_t		argType		=	argumentMap[argumentIdx*2 + 1];
-		TemplateArgPair*	argPair		=	NULL;
-
-		//printf("\n %08X : [%02X %02X %02X] Arg %" PRIX64" type %08X len %08X\n",
-		//		(uint32_t)ctx->offset, ctx->data[ctx->offset], ctx->data[ctx->offset+1], ctx->data[ctx->offset+2],
-		//		argumentIdx, argType, argLen);
-		auto it = ctx->currentTemplatePtr->args.find(argumentIdx);
-		if ( it != ctx->currentTemplatePtr->args.end() ) {
-			argPair = &it->second;
-		}
-
-		if ( argPair == NULL )
-		{
-			// printf("Argument not found\n");
-			ctx->SkipBytes(argLen);
-		}
-		else
-		{
-			uint8_t		v_b;
-			uint16_t	v_w;
-			uint32_t	v_d;
-			uint64_t	v_q;
-			time_t		unixTimestamp;
-			struct tm	localtm;
-			struct tm*	t;
-			uint8_t		sid[2+6];
-			EvtxGUID	guid;
-			uint64_t stringNumUsed	=	0;
-			uint64_t stringSize	=	0;
-
-			switch(argType)
-			{
-			//// case 0x00:	/*  void */
-				//break;
-			case 0x01:	/*  String */ {
-				stringSize = argLen*2+2;
-				std::vector<char> stringBuffer(stringSize);
-				for (uint64_t idx = 0; idx < argLen/2; idx++)
-				{
-					if ( !ctx->ReadData(&v_w) )
-						return false;
-					UTF16ToUTF8(v_w, &stringBuffer[0], &stringNumUsed, stringSize);
-				}
-				if ( stringNumUsed >= stringSize )
-					stringNumUsed = stringSize - 1;
-				stringBuffer[stringNumUsed] = 0;
-				printf("'%s':'%s', ", argPair->key, &stringBuffer[0]);
-				}
-				break;
-            case 0x02:  /*  AnsiStringType  */ {
-				stringSize = argLen+1;
-				std::vector<char> stringBuffer(stringSize);
-				for (uint64_t idx = 0; idx < argLen; idx++)
-				{
-					if ( !ctx->ReadData(&v_b) )
-						return false;
-                    stringBuffer[idx] = v_b;
-				}
-				stringBuffer[argLen] = 0;
-				printf("'%s':'%s', ", argPair->key, &stringBuffer[0]);
-				}
-				break;
-			case 0x04:	/*  uint8_t */
-				if ( !ctx->ReadData(&v_b) )
-					return false;
-				printf("'%s':%02u, ", argPair->key, v_b);
-				break;
-			case 0x06:	/*  uint16_t */
-				if ( !ctx->ReadData(&v_w) )
-					return false;
-
-				if ( !strcmp(argPair->key, "EventID") && ( eventDescriptionHashTable.find(v_w) != eventDescriptionHashTable.end()))
-					printf("'%s':%04u (%s), ", argPair->key, v_w, eventDescriptionHashTable[v_w].c_str());
-				else
-					printf("'%s':%04u, ", argPair->key, v_w);
-				break;
-			case 0x08:	/*  uint32_t */
-				if ( !ctx->ReadData(&v_d) )
-					return false;
-
-				if ( !strcmp(argPair->key, "LogonType") && ( v_d <= 11 ) && ( logonTypes[v_d] != NULL ))
-					printf("'%s':%08u (%s), ", argPair->key, v_d, logonTypes[v_d]);
-				else if ( !strcmp(argPair->key, "Address1") || !strcmp(argPair->key, "Address2") )
-				{
-					uint8_t*	ipPtr	=	reinterpret_cast<uint8_t*>(&v_d);
-					printf("'%s':%08u (%u.%u.%u.%u), ", argPair->key, v_d, ipPtr[0], ipPtr[1], ipPtr[2], ipPtr[3]);
-				}
-				else
-					printf("'%s':%08u, ", argPair->key, v_d);
-				break;
-			case 0x0A:	/*  uint64_t */
-				if ( !ctx->ReadData(&v_q) )
-					return false;
-				printf("'%s':%016" PRIu64 ", ", argPair->key, v_q);
-				break;
-			case 0x0E:	/*  binary */
-				printf("'%s':", argPair->key);
-				for (uint64_t idx = 0; idx < argLen; idx++)
-				{
-					if ( !ctx->ReadData( &v_b) )
-						return false;
-					printf("%02X", v_b);
-				}
-				printf(", ");
-				break;
-			case 0x0F:	/* GUID */
-				if ( !ctx->ReadData( &guid) )
-					return false;
-				printf("'%s':%08X-%02X-%02X-%02X%02X%02X%02X%02X%02X%02X%02X, ", argPair->key,
-						guid.d1, guid.w1, guid.w2,
-						guid.b1[0], guid.b1[1], guid.b1[2], guid.b1[3],
-						guid.b1[4], guid.b1[5], guid.b1[6], guid.b1[7]);
-				break;
-			case 0x14:	/*  HexInt32 */
-				if ( !ctx->ReadData(&v_d) )
-					return false;
-				printf("'%s':%08" PRIX32", ", argPair->key, v_d);
-				break;
-
-			case 0x15:	/*  HexInt64 */
-				if ( !ctx->ReadData(&v_q) )
-					return false;
-				printf("'%s':%016" PRIX64 ", ", argPair->key, v_q);
-				break;
-			case 0x11:	/*  FileTime */
-				if ( !ctx->ReadData( &v_q) )
-					return false;
-				unixTimestamp = UnixTimeFromFileTime(v_q);
-				t = gmtime_r(&unixTimestamp, &localtm);
-				if ( t == NULL )
-					printf("'%s':%016" PRIX64 ", ", argPair->key, v_q);
-				else
-					printf("'%s':%04u.%02u.%02u-%02u:%02u:%02u, ",
-							argPair->key,
-							t->tm_year+1900, t->tm_mon+1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec);
-				break;
-			case 0x13:	/*  SID */
-				if ( argLen < sizeof(sid) )
-					return false;
-				if ( !ctx->ReadData(sid, sizeof(sid)) )
-					return false;
-				v_q = 0;
-				for (uint64_t idx = 0; idx < 6; idx++)
-				{
-					v_q <<= 8;
-					v_q |= sid[2+idx];
-				}
-				printf("'%s':S-%u-%" PRIu64 "", argPair->key, sid[0], v_q);
-				for (uint64_t idx = sizeof(sid); idx + 4 <= argLen; idx += 4)
-				{
-					if ( !ctx->ReadData( &v_d) )
-						return false;
-					printf("-%u", v_d);
-				}
-				printf(", ");
-				break;
-			case 0x21:	/*  BinXml */
-				{
-					ParseContext	temporaryCtx(*ctx);
-					temporaryCtx.UpdateLen(temporaryCtx.offset + argLen);
-					if ( !ParseBinXml(&temporaryCtx, 0) )
-						;//return false;
-					// printf("=====<<<<< %08X\n", argLen);
-					ctx->SkipBytes(argLen);
-				}
-				break;
-			case 0x81:	/*  StringArray */
-				{
-					/*  Null terminated unicode strings */
-					ParseContext	temporaryCtx(*ctx);
-					bool		inString		=	false;
-
-					temporaryCtx.UpdateLen(temporaryCtx.offset + argLen);
-
-					printf("'%s':[", argPair->key);
-
-					while ( 1 )
-					{
-						char	utf8Buffer[8];
-						uint64_t utf8BufferUsed;
-
-						if ( !temporaryCtx.ReadData( &v_w) )
-							break;
-
-						if ( v_w == '\r' || v_w == '\n' )
-							v_w = ' ';
-
-						if ( v_w == 0x0000 )
-						{
-							if ( inString )
-							{
-								printf("',");
-								inString = false;
-							}
-						}
-						else
-						{
-							utf8BufferUsed = 0;
-							UTF16ToUTF8(v_w, utf8Buffer, &utf8BufferUsed, sizeof(utf8Buffer));
-							utf8Buffer[utf8BufferUsed] = 0;
-							printf("%s%s", inString ? "" : "'", utf8Buffer);
-							inString = true;
-						}
-					}
-
-					printf("%s], ", inString ? "'" : "");
-
-					ctx->SkipBytes(argLen);
-				}
-				break;
-			default:
-				if ( argType != 0x00 )
-					printf("'%s':'...//%04X[%04X]', ", argPair->key, argPair->type, argLen);
-				ctx->SkipBytes(argLen);
-				break;
-			}
-		}
-
-		totalArgLen += argLen;
-	}
-
-	return true;
 }
 
-
-bool	ParseOptionalSubstitution(ParseContext* ctx)
+/*  KEY[,KEY...] as printed, e.g. EventID,SystemTime,TargetUserName */
+bool	ParseFieldList(const char* str, std::vector<std::string>& fields)
 {
-	uint16_t	substitutionID;
-	uint8_t		valueType;
-
-	if ( !ctx->ReadData(&substitutionID) )
-		return false;
-	if ( !ctx->ReadData(&valueType) )
-		return false;
-	if ( valueType == 0x00 )
+	while ( 1 )
 	{
-		if ( !ctx->ReadData(&valueType) )
+		const char*	end	=	strchr(str, ',');
+		size_t		len	=	( end != NULL ) ? end - str : strlen(str);
+
+		if ( len == 0 )
 			return false;
+		fields.push_back(std::string(str, len));
+		if ( end == NULL )
+			return true;
+		str = end + 1;
 	}
+}
 
-	// printf("******* %s=<<param %X/type %X>> ", nameStack.GetName(), substitutionID, valueType);
-	if ( ctx->currentTemplatePtr != nullptr ) {
-		ctx->currentTemplatePtr->RegisterArgPair(GetProperKeyName(ctx), valueType, substitutionID);
-	}
-	SetState(ctx, StateNormal);
+#ifdef _WIN32
 
-	return true;
-}
+#if !defined(__MINGW64_VERSION_MAJOR) && !defined(_MSC_VER)
 
-bool	ParseBinXmlPre(const uint8_t* data, uint64_t dataLen, uint64_t chunkOffsetInFile, uint64_t inChunkOffset)
+extern "C"
 {
-	ParseContext	ctx;
-
-	ctx.data = data;
-	ctx.dataLen = dataLen;
-	ctx.offset = inChunkOffset;
-	ctx.currentTemplatePtr = nullptr;
-	ctx.chunkContext = &ctx;
-	ctx.offsetFromChunkStart = 0;
-	ctx.cachedValue[0] = 0;
+BOOL (WINAPI *Wow64DisableWow64FsRedirection)(
+  PVOID *OldValue
+)	= (BOOL(WINAPI*)(PVOID*))GetProcAddress(GetModuleHandle(L"KERNEL32.DLL"), "Wow64DisableWow64FsRedirection");
 
-	return ParseBinXml(&ctx, chunkOffsetInFile);
+BOOL (WINAPI * Wow64RevertWow64FsRedirection)(
+  PVOID OldValue )
+	= (BOOL(WINAPI*)(PVOID))GetProcAddress(GetModuleHandle(L"KERNEL32.DLL"), "Wow64RevertWow64FsRedirection");
 }
 
-bool	ParseBinXml(ParseContext* ctx, uint64_t chunkOffsetInFile) {
-	bool	result	=	true;
-
-	ctx->state = StateNormal;
-
-#if defined(PRINT_TAGS)
-	printf("ParseBinXml(%08X, %08X)\n", (uint32_t)ctx->offset, (uint32_t)ctx->dataLen);
-#endif
-
-	while ( result && ( ctx->offset < ctx->dataLen ) )
-	{
-		uint8_t	tag	=	ctx->data[ctx->offset++];
-
-#if defined(PRINT_TAGS)
-		uint64_t realOffset = chunkOffsetInFile + ctx->offset + ( ctx->data - ctx->chunkContext->data );
-
-		printf("%08zX: %02X ", realOffset, tag);
-		printf("%08zX: %02X %02X %02X", realOffset, tag, ctx->data[ctx->offset], ctx->data[ctx->offset+1]);
-		fflush(stdout);
 #endif
 
-		switch(tag)
-		{
-		case 0x00:	/*  EOF */
-			ctx->offset = ctx->dataLen;
-			break;
-		case 0x01:	/*  OpenStartElementToken */
-			result = ParseOpenStartElement(ctx, false);
-			break;
-		case 0x41:
-			result = ParseOpenStartElement(ctx, true);
-			break;
-		case 0x02:	/* CloseStartElementToken */
-			result = ParseCloseStartElement(ctx);
-			break;
-		case 0x03:	/*  CloseEmptyElementToken */
-		case 0x04:	/*  CloseElementToken */
-			result = ParseCloseElement(ctx);
-			break;
-		case 0x05:	/*  ValueTextToken */
-		case 0x45:
-			result = ParseValueText(ctx);
-			break;
-		case 0x06:	/*  AttributeToken */
-		case 0x46:
-			result = ParseAttributes(ctx);
-			break;
-		case 0x07:	/* CDATASectionToken */
-		case 0x47:
-			break;
-		case 0x08:	/* CharRefToken */
-		case 0x48:
-			break;
-		case 0x09:	/*  EntityRefToken */
-		case 0x49:
-			break;
-		case 0x0A:	/*  PITargetToken */
-			break;
-		case 0x0B:	/*  PIDataToken */
-			break;
-		case 0x0C: /*  TemplateInstanceToken */
-			result = ParseTemplateInstance(ctx);
-			break;
-		case 0x0D:	/*  NormalSubstitutionToken */
-		case 0x0E:	/*  OptionalSubstitutionToken */
-			result = ParseOptionalSubstitution(ctx);
-			break;
-		case 0x0F: /*  FragmentHeaderToken */
-			ctx->SkipBytes( 3);
-			break;
-
-		default:
-			result = false;
-			break;
-		}
-
-#if defined(PRINT_TAGS)
-		printf("\n");
 #endif
-	}
 
-	return result;
 }
 
-bool	ParseEVTXInt(int f) {
-	EvtxHeader	header;
-	uint64_t	off	=	0;
-	std::vector<uint8_t> chunk(EVTX_CHUNK_SIZE);
-	bool		result	=	true;
-
-	if ( read(f, &header, sizeof(header)) != sizeof(header) )
-		return false;
-	if ( header.version != 0x00030001 && header.version != 0x00030002)
-		return false;
+int main(int argc, char* argv[]) {
+	void*	redir;
 
-#ifdef PRINT_TAGS
-	printf("Number of chunks: %" PRIu64 " %" PRIu64 " header sz %zu\n", header.numberOfChunksAllocated, header.numberOfChunksUsed, sizeof(header));
+#ifdef _WIN32
+	if (Wow64DisableWow64FsRedirection != NULL )
+		Wow64DisableWow64FsRedirection(&redir);
 #endif
 
-	off = sizeof(header);
+	EvtxOptions		options;
+	BatchOptions		batch;
+	FollowOptions		follow;
+	EvtxParser*		parser;
+	std::vector<BatchFile>	files;
+	bool			merge	=	false;
 
-	while ( result )
-	{
-		EvtxChunkHeader*	chunkHeader	=	reinterpret_cast<EvtxChunkHeader*>(&chunk[0]);
-
-		ResetTemplates();
-		nameStack.Reset();
-
-#ifdef _WIN32
-#define lseek64 _lseeki64
-#endif
-#ifdef __MACH__
-        static_assert(sizeof(off_t) == 8, "Unsupported lseek() implementation on Mach");
-        #define lseek64 lseek
-#endif
-		if ( lseek64(f, off, SEEK_SET) != off )
-		{
-			result = false;
-			break;
+	for (int idx = 1; idx < argc; idx++) {
+		if ( !strncmp(argv[idx], "-j", 2) || !strncmp(argv[idx], "-P", 2) ) {
+			char		option	=	argv[idx][1];
+			const char*	value	=	&argv[idx][2];
+			uint64_t	count	=	0;
+
+			/*  a bare -j or -P only takes the next argument if it is a count, not a file name */
+			if ( !*value ) {
+				if ( idx + 1 < argc && ParseCount(argv[idx + 1], UINT32_MAX, &count) )
+					idx++;
+			} else if ( !ParseCount(value, UINT32_MAX, &count) ) {
+				fprintf(stderr, "Invalid value for -%c: %s\n", option, value);
+				return 1;
+			}
+			if ( count == 0 )
+				count = std::thread::hardware_concurrency();
+			if ( option == 'j' )
+				options.numThreads = count;
+			else
+				batch.numFiles = count;
+			continue;
 		}
-		if ( read(f, &chunk[0], chunk.size()) != chunk.size() )
-			break;
-
-		if ( memcmp(chunkHeader->magic, EVTX_CHUNK_HEADER_MAGIC, sizeof(EVTX_CHUNK_HEADER_MAGIC)) )
-		{
-			// result = false;
-			break;
+		if ( !strcmp(argv[idx], "-o") && idx + 1 < argc ) {
+			batch.outputDir = argv[++idx];
+			continue;
 		}
-
-		// printf("Chunk %" PRIu64 " .. %" PRIu64 "\n", chunkHeader->firstRecordNumber, chunkHeader->lastRecordNumber);
-
-		uint64_t inRecordOff = sizeof(*chunkHeader);
-
-		while ( result )
-		{
-			EvtxRecordHeader*	recordHeader	=	reinterpret_cast<EvtxRecordHeader*>(&chunk[inRecordOff]);
-			time_t			unixTimestamp;
-			struct tm		localtm;
-			struct tm*		t;
-
-			if ( inRecordOff + sizeof(*recordHeader) > chunk.size() )
-				break;
-
-			if ( recordHeader->magic != 0x00002a2a )
-			{
-#ifdef PRINT_TAGS
-				printf("Record header mismatch at %08X\n", (uint32_t)(off + inRecordOff));
-#endif
-				break;
+		if ( !strncmp(argv[idx], "--format=", 9) ) {
+			const char*	format	=	argv[idx] + 9;
+
+			if ( !strcmp(format, "jsonl") || !strcmp(format, "json") )
+				options.format = EvtxFormatJsonLines;
+			else if ( !strcmp(format, "csv") )
+				options.format = EvtxFormatCsv;
+			else if ( !strcmp(format, "raw") )
+				options.format = EvtxFormatRaw;
+			else if ( !strcmp(format, "arrow") )
+				options.format = EvtxFormatArrow;
+			else if ( !strcmp(format, "xml") )
+				options.format = EvtxFormatXml;
+			else {
+				fprintf(stderr, "Unknown output format %s\n", format);
+				return 1;
 			}
-
-			unixTimestamp = UnixTimeFromFileTime(recordHeader->timestamp);
-			t = gmtime_r(&unixTimestamp, &localtm);
-			if ( t == NULL )
-			{
-				result = false;
-				break;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--xml") ) {
+			options.format = EvtxFormatXml;
+			continue;
+		}
+		if ( !strncmp(argv[idx], "--merge=", 8) ) {
+			const char*	order	=	argv[idx] + 8;
+
+			if ( !strcmp(order, "time") )
+				options.mergeOrder = EvtxOrderTime;
+			else if ( !strcmp(order, "record") )
+				options.mergeOrder = EvtxOrderRecordNumber;
+			else {
+				fprintf(stderr, "Unknown merge order %s\n", order);
+				return 1;
 			}
+			merge = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--merge-window") && idx + 1 < argc ) {
+			const char*	value	=	argv[++idx];
+			uint64_t	size;
 
-			// printf("%" PRIX64 ": Record %" PRIu64 " %04u.%02u.%02u-%02u:%02u:%02u ", inRecordOff, recordHeader->number, t->tm_year+1900, t->tm_mon+1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec);
-			printf("Record #%" PRIu64 " %04u-%02u-%02uT%02u:%02u:%02uZ ", recordHeader->number, t->tm_year+1900, t->tm_mon+1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec);
-
-			if ( !ParseBinXmlPre(&chunk[0],
-						chunk.size(),
-						off,
-						inRecordOff + sizeof(*recordHeader) ) )
-			{
-				if ( recordHeader->number >= chunkHeader->firstRecordNumber &&
-						recordHeader->number <= chunkHeader->lastRecordNumber )
-				{
-					result = false;
-				}
-				break;
+			if ( !ParseCount(value, UINT64_MAX >> 20, &size) ) {
+				fprintf(stderr, "Invalid value for --merge-window: %s\n", value);
+				return 1;
 			}
-			printf("\n");
-
-			inRecordOff += recordHeader->size;
+			options.mergeWindow = size << 20;
+			continue;
 		}
+		if ( !strncmp(argv[idx], "--time-precision=", 17) ) {
+			const char*	precision	=	argv[idx] + 17;
+
+			if ( !strcmp(precision, "s") )
+				options.timePrecision = EvtxTimeSeconds;
+			else if ( !strcmp(precision, "us") )
+				options.timePrecision = EvtxTimeMicroseconds;
+			else if ( !strcmp(precision, "100ns") )
+				options.timePrecision = EvtxTime100ns;
+			else {
+				fprintf(stderr, "Unknown time precision %s\n", precision);
+				return 1;
+			}
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--event-id") || !strcmp(argv[idx], "--record-range") ||
+				!strcmp(argv[idx], "--since") || !strcmp(argv[idx], "--until") || !strcmp(argv[idx], "--fields") ||
+				!strcmp(argv[idx], "--summarize") ) {
+			const char*	option	=	argv[idx];
+			const char*	value	=	( idx + 1 < argc ) ? argv[++idx] : "";
+			uint64_t	fileTime;
+			uint64_t	resolution;
+			bool		valid;
+
+			if ( !strcmp(option, "--event-id") ) {
+				valid = ParseEventIDList(value, options.eventIDs);
+			} else if ( !strcmp(option, "--record-range") ) {
+				valid = ParseRecordRange(value, options);
+			} else if ( !strcmp(option, "--fields") ) {
+				valid = ParseFieldList(value, options.fields);
+			} else if ( !strcmp(option, "--summarize") ) {
+				valid = ParseFieldList(value, options.summaryKeys);
+			} else {
+				valid = ParseFilterTime(value, &fileTime, &resolution);
+				if ( valid && option[2] == 's' )
+					options.since = fileTime;
+				else if ( valid )
+					options.until = fileTime + resolution - 1;	/*  the whole day/minute/second */
+			}
+			if ( !valid ) {
+				fprintf(stderr, "Invalid value for %s: %s\n", option, value);
+				return 1;
+			}
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--follow") ) {
+			follow.enabled = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--checkpoint") && idx + 1 < argc ) {
+			follow.checkpointName = argv[++idx];
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--verify") ) {
+			options.verify = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--carve") ) {
+			options.carve = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--build-index") ) {
+			options.buildIndex = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--stats") ) {
+			options.collectStats = true;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--no-mmap") ) {
+			options.useMmap = false;
+			continue;
+		}
+		if ( !strcmp(argv[idx], "--read-ahead") && idx + 1 < argc ) {
+			const char*	value	=	argv[++idx];
+			uint64_t	count;
 
-		off += chunk.size();
-
-		if ( inRecordOff > off )
-		{
-			result = false;
-			break;
+			if ( !ParseCount(value, UINT32_MAX, &count) ) {
+				fprintf(stderr, "Invalid value for --read-ahead: %s\n", value);
+				return 1;
+			}
+			options.readAhead = count;
+			continue;
 		}
+		AddInput(files, argv[idx]);
 	}
 
-	return result;
-}
+	if ( follow.enabled ) {
+		if ( files.size() != 1 ) {
+			fprintf(stderr, "--follow needs exactly one input file\n");
+			return 1;
+		}
+	}
 
-bool	ParseEVTX(const char* fileName) {
-	bool	result;
-	int	f	=	open(fileName, O_RDONLY|O_BINARY);
-	if ( f < 0 )
-		return false;
+	if ( options.carve && ( follow.enabled || options.buildIndex ) ) {
+		fprintf(stderr, "--carve can't be combined with --follow or --build-index\n");
+		return 1;
+	}
 
-	result = ParseEVTXInt(f);
-	if ( !result )
-		printf("Failed on %s\n", fileName);
-	close(f);
-	return result;
-}
+	if ( merge && ( follow.enabled || options.buildIndex || !batch.outputDir.empty() || options.format == EvtxFormatArrow ) ) {
+		fprintf(stderr, "--merge can't be combined with --follow, --build-index, -o or --format=arrow\n");
+		return 1;
+	}
 
-void InitEventDescriptions(void) {
-	for (size_t idx = 0; idx < sizeof(eventDescriptions)/sizeof(eventDescriptions[0]); idx++)
-	{
-		char*		nptr	=	NULL;
-		uint16_t	eventID	=	strtoul(eventDescriptions[idx], &nptr, 10);
-		if ( ( nptr == NULL ) || ( eventID == 0 ) )
-			continue;
-		while (*nptr != ')' && *nptr != 0)
-			nptr++;
-		while (*nptr == ' ' || *nptr == ')')
-			nptr++;
-		// printf("%04u - %s\n", eventID, nptr);
-		eventDescriptionHashTable[eventID] = nptr;
+	if ( !options.summaryKeys.empty() && ( follow.enabled || options.buildIndex || merge || !batch.outputDir.empty() ) ) {
+		fprintf(stderr, "--summarize can't be combined with --follow, --build-index, --merge or -o\n");
+		return 1;
 	}
-}
 
+	if ( options.format == EvtxFormatArrow ) {
+		/*  a stream per input, one after the other would not be readable */
+		if ( follow.enabled || ( files.size() > 1 && batch.outputDir.empty() ) ) {
+			fprintf(stderr, "--format=arrow can't be combined with --follow, and needs -o DIR for several inputs\n");
+			return 1;
+		}
 #ifdef _WIN32
-
-#if !defined(__MINGW64_VERSION_MAJOR) && !defined(_MSC_VER)
-
-extern "C"
-{
-BOOL (WINAPI *Wow64DisableWow64FsRedirection)(
-  PVOID *OldValue
-)	= (BOOL(WINAPI*)(PVOID*))GetProcAddress(GetModuleHandle(L"KERNEL32.DLL"), "Wow64DisableWow64FsRedirection");
-
-BOOL (WINAPI * Wow64RevertWow64FsRedirection)(
-  PVOID OldValue )
-	= (BOOL(WINAPI*)(PVOID))GetProcAddress(GetModuleHandle(L"KERNEL32.DLL"), "Wow64RevertWow64FsRedirection");
-}
-
-#endif
-
+		_setmode(_fileno(stdout), _O_BINARY);
 #endif
+	}
 
-}
+	parser = EvtxCreateParser(options);
+	if ( follow.enabled )
+		EvtxFollowFile(parser, files[0].name.c_str(), follow.checkpointName.empty() ? NULL : follow.checkpointName.c_str(), stdout);
 
-int main(int argc, char* argv[]) {
-	void*	redir;
+	if ( merge ) {
+		std::vector<std::string>	fileNames;
 
-#ifdef _WIN32
-	if (Wow64DisableWow64FsRedirection != NULL )
-		Wow64DisableWow64FsRedirection(&redir);
-#endif
-
-	InitEventDescriptions();
-	for (int idx = 1; idx < argc; idx++) {
-		ParseEVTX(argv[idx]);
+		for (auto& file : files)
+			fileNames.push_back(file.name);
+		EvtxMergeFiles(parser, fileNames, batch.numFiles, stdout);
+	} else {
+		ParseBatch(files, parser, batch, options.format);
 	}
+	EvtxPrintSummary(parser, stdout);
+	EvtxPrintStats(parser, stderr);
+	EvtxDestroyParser(parser);
 
 #ifdef _WIN32
 	if (Wow64RevertWow64FsRedirection != NULL)
@@ -1163,4 +626,3 @@ int main(int argc, char* argv[]) {
 
 	return 0;
 }
-
@@ -0,0 +1,137 @@
+/*
+ *       Filename:  utf16.h
+ *    Description:  Bulk UTF-16LE to UTF-8 conversion with a vectorized ASCII fast path
+ */
+
+#ifndef utf16_h_included
+#define utf16_h_included
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define UTF16_USE_SSE2	1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UTF16_USE_AVX2	1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define UTF16_USE_NEON	1
+#endif
+
+/*  Converts numUnits little-endian UTF-16 code units from src (no alignment required) into dst.
+ *  Surrogate pairs become one 4-byte sequence, unpaired surrogates become U+FFFD.
+ *  Stops before the first character that does not fit into dstSize bytes, nothing is NUL-terminated.
+ *  Returns the number of bytes written */
+static size_t UTF16ToUTF8Bulk(const uint8_t* src, size_t numUnits, char* dst, size_t dstSize)
+{
+	size_t	in	=	0;
+	size_t	out	=	0;
+
+	while ( in < numUnits )
+	{
+		size_t	scalarEnd;
+
+#if defined(UTF16_USE_AVX2)
+		while ( in + 16 <= numUnits && out + 16 <= dstSize )
+		{
+			__m256i	v	=	_mm256_loadu_si256((const __m256i*)(src + in * 2));
+
+			if ( !_mm256_testz_si256(v, _mm256_set1_epi16((short)0xFF80)) )
+				break;
+			_mm_storeu_si128((__m128i*)(dst + out), _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+			in += 16;
+			out += 16;
+		}
+#endif
+#if defined(UTF16_USE_SSE2)
+		while ( in + 8 <= numUnits && out + 8 <= dstSize )
+		{
+			__m128i	v	=	_mm_loadu_si128((const __m128i*)(src + in * 2));
+			__m128i	high	=	_mm_and_si128(v, _mm_set1_epi16((short)0xFF80));
+
+			if ( _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF )
+				break;
+			_mm_storel_epi64((__m128i*)(dst + out), _mm_packus_epi16(v, v));
+			in += 8;
+			out += 8;
+		}
+#endif
+#if defined(UTF16_USE_NEON)
+		while ( in + 8 <= numUnits && out + 8 <= dstSize )
+		{
+			uint16x8_t	v	=	vreinterpretq_u16_u8(vld1q_u8(src + in * 2));
+
+			if ( vmaxvq_u16(v) >= 0x80 )
+				break;
+			vst1_u8((uint8_t*)(dst + out), vmovn_u16(v));
+			in += 8;
+			out += 8;
+		}
+#endif
+
+		/*  a few characters one by one before trying the vector path again */
+		scalarEnd = ( numUnits - in > 8 ) ? in + 8 : numUnits;
+		while ( in < scalarEnd )
+		{
+			uint32_t	c	=	src[in * 2] | ( src[in * 2 + 1] << 8 );
+			size_t		units	=	1;
+
+			if ( c >= 0xD800 && c <= 0xDFFF )
+			{
+				uint32_t	low	=	( in + 1 < numUnits ) ? ( src[in * 2 + 2] | ( src[in * 2 + 3] << 8 ) ) : 0;
+
+				if ( c <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF )
+				{
+					c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+					units = 2;
+				}
+				else
+				{
+					c = 0xFFFD;
+				}
+			}
+
+			if ( c < 0x80 )
+			{
+				if ( out + 1 > dstSize )
+					return out;
+				dst[out++] = (char)c;
+			}
+			else if ( c < 0x800 )
+			{
+				if ( out + 2 > dstSize )
+					return out;
+				dst[out++] = (char)( 0xC0 | ( c >> 6 ) );
+				dst[out++] = (char)( 0x80 | ( c & 0x3F ) );
+			}
+			else if ( c < 0x10000 )
+			{
+				if ( out + 3 > dstSize )
+					return out;
+				dst[out++] = (char)( 0xE0 | ( c >> 12 ) );
+				dst[out++] = (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+				dst[out++] = (char)( 0x80 | ( c & 0x3F ) );
+			}
+			else
+			{
+				if ( out + 4 > dstSize )
+					return out;
+				dst[out++] = (char)( 0xF0 | ( c >> 18 ) );
+				dst[out++] = (char)( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+				dst[out++] = (char)( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+				dst[out++] = (char)( 0x80 | ( c & 0x3F ) );
+			}
+			in += units;
+		}
+	}
+
+	return out;
+}
+
+#endif
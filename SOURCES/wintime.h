@@ -17,5 +17,39 @@ static uint64_t UnixTimeFromFileTime(uint64_t fileTime)
 	return ( fileTime - 11644473600000ULL * 10000) / 10000000;
 }
 
+static uint64_t FileTimeFromUnixTime(uint64_t unixTime)
+{
+	return unixTime * 10000000 + 11644473600000ULL * 10000;
+}
+
+/*  Number of days since 1970-01-01 of a proleptic Gregorian date */
+static int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+	year -= ( month <= 2 );
+
+	int64_t		era	=	( year >= 0 ? year : year - 399 ) / 400;
+	unsigned	yoe	=	(unsigned)( year - era * 400 );
+	unsigned	doy	=	( 153 * ( month > 2 ? month - 3 : month + 9 ) + 2 ) / 5 + day - 1;
+	unsigned	doe	=	yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+/*  The other way round, days since 1970-01-01 to year, month (1-12) and day (1-31) */
+static void CivilFromDays(int64_t days, int64_t* year, unsigned* month, unsigned* day)
+{
+	days += 719468;
+
+	int64_t		era	=	( days >= 0 ? days : days - 146096 ) / 146097;
+	unsigned	doe	=	(unsigned)( days - era * 146097 );
+	unsigned	yoe	=	( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+	unsigned	doy	=	doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+	unsigned	mp	=	( 5 * doy + 2 ) / 153;
+
+	*day = doy - ( 153 * mp + 2 ) / 5 + 1;
+	*month = ( mp < 10 ) ? mp + 3 : mp - 9;
+	*year = (int64_t)yoe + era * 400 + ( *month <= 2 );
+}
+
 #endif
 